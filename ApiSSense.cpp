@@ -7,12 +7,25 @@
 #include "semphr.h"
 #include "MCP23017.h"
 #include "HX711.h"
+#include "BeeGateMatcher.h"
+#include "GateEventRing.h"
+#include "I2CEngine.h"
+#include "I2CDmaTransport.h"
+#include "VocStateStore.h"
+#include "WallClock.h"
+#include "CoreAffinity.h"
+#include "CoreLoad.h"
+#include "KernelMemory.h"
+#include "LowPower.h"
+#include "SensorScheduler.h"
 
 extern "C" {
     // Bibliotecas do SGP40 
     #include "sensirion_i2c_hal.h"
     #include "sgp40_i2c.h"
     #include "sensirion_gas_index_algorithm.h"
+    // Codificacao da telemetria
+    #include "telemetry.h"
 }
 
 #include "pico/cyw43_arch.h"        // Biblioteca para arquitetura Wi-Fi da Pico com CYW43  
@@ -33,34 +46,74 @@ unsigned long mbedtls_ms_time(void) {
 #define I2C_PORT i2c0
 #define I2C_SDA 0
 #define I2C_SCL 1
+I2CDmaTransport i2cTransport(I2C_PORT, I2C_SDA, I2C_SCL, 400 * 1000);
+I2CEngine i2cBus KERNEL_MEMORY(i2c) (&i2cTransport); // Compartilhado por MCP23017 e SGP40
 
 // --- EXPANSORES (MCP23017) --- 
-// Endereços e GPIO da ISR dos Expansores MCP23017
-#define EXPANDER1_ADDR 0x20
-#define EXPANDER1_INT_PIN 9
-// Tamanho da fila de cada par de sensor
-#define BEE_QUEUE_LENGTH 5
-#define NUM_CHANNELS_MCP 8
-// Timeouts para os estados das abelhas (ms)
-#define BEE_EVENT_TIMEOUT_MS 5000 // Tempo para descartar abelhas que nao completam a passagem
-#define BEE_PASSAGE_WINDOW_MS 2000 // Janela para aceitar uma passagem de abelha (A->B e B->A)
-
-// Expansores (MCP23017) conectados
-MCP23017 expander1(EXPANDER1_ADDR, EXPANDER1_INT_PIN);
-// Filas para cada expansor
-QueueHandle_t beeQueue1[2][NUM_CHANNELS_MCP]; // [0][X] PortA e [1][X] PortB
-// Semáforo para sinalizar interrupção de cada expansor
-SemaphoreHandle_t xSemaphoreInt1;
+#define MAX_EXPANDERS 8 // Enderecos 0x20 a 0x27 no mesmo barramento
+#define NUM_CHANNELS_MCP 8 // Pares de sensores por expansor (GPAx -> GPBx)
+// Janela para aceitar uma passagem de abelha (A->B e B->A). Eventos sem par
+// depois desse tempo nunca mais vao casar e sao descartados
+#define BEE_PASSAGE_WINDOW_MS 2000
+#define BEE_PASSAGE_WINDOW_US (BEE_PASSAGE_WINDOW_MS * 1000u)
+
+typedef struct{
+    MCP23017 device;   // Endereco I2C (0x20-0x27) e GPIO ligado ao INT (MIRROR = 1)
+    uint8_t gate_mask; // Pares instalados: bit i = GPAi (entrada) + GPBi (dentro)
+} bee_expander_t;
+
+// Topologia da colmeia. Cada linha e um expansor: para adicionar um expansor basta
+// uma linha aqui, sem novas tasks, semaforos ou filas. Cada expansor precisa do
+// proprio GPIO de INT, ja que o INT fica em nivel baixo ate ser atendido.
+// O canal de um par e (indice do expansor * NUM_CHANNELS_MCP + pino).
+bee_expander_t expanders[] = {
+    {MCP23017(0x20, 9), 0xFF},
+    // {MCP23017(0x21, 10), 0xFF},
+    // {MCP23017(0x22, 11), 0x0F},
+};
+#define NUM_EXPANDERS (sizeof(expanders) / sizeof(expanders[0]))
+static_assert(NUM_EXPANDERS <= MAX_EXPANDERS, "No maximo 8 MCP23017 (0x20-0x27) no barramento");
+static_assert(MAX_EXPANDERS * NUM_CHANNELS_MCP <= BEE_GATE_MAX_CHANNELS, "BEE_GATE_MAX_CHANNELS nao cobre todos os canais");
+
+// Mapa GPIO -> expansores que usam esse pino de INT (bit por expansor)
+uint8_t irq_pin_expanders[NUM_BANK0_GPIOS];
+// Instante (us) da ultima interrupcao de cada expansor, registrado na propria ISR
+volatile uint32_t expander_irq_time[MAX_EXPANDERS];
+// Task que atende os expansores: recebe a mascara de pendentes na notificacao
+TaskHandle_t xExpanderServiceTask = NULL;
+
+// Eventos dos sensores: vExpanderService (produtor) -> vBeeMatcherTask (consumidor)
+GateEventRing gateEvents;
+// Maquina de estados que casa os eventos de entrada/saida de cada canal
+// Tempos em microssegundos (time_us_32, parte baixa do timer de 64 bits)
+BeeGateMatcher beeMatcher(BEE_PASSAGE_WINDOW_US);
+TaskHandle_t xBeeMatcherTask = NULL;
 
 // Contador principal de abelhas 
 typedef struct{
     int32_t in;
     int32_t out;
 } bee_counter_t;
+// Escrito no nucleo dos sensores e lido no do radio: acesso so pela secao
+// critica (no SMP ela tambem trava o outro nucleo), e o par in/out sai sempre
+// da mesma atualizacao
 bee_counter_t bee_counter;
 
-// Mutex para proteger acesso ao contador
-SemaphoreHandle_t xMutexCounter;
+static bee_counter_t bee_counter_get(){
+    bee_counter_t copy;
+    taskENTER_CRITICAL();
+    copy = bee_counter;
+    taskEXIT_CRITICAL();
+    return copy;
+}
+
+// Ocupacao de cada nucleo (statisticsJob)
+CoreLoad coreLoad;
+
+// Amostragens periodicas: um worker no nucleo dos sensores e outro no do
+// radio, para os relatorios MQTT (SensorScheduler.h)
+SensorScheduler sensorScheduler KERNEL_MEMORY(sensors);
+SensorScheduler reportScheduler KERNEL_MEMORY(radio);
 
 
 // --- Favos de Mel (LOADCELL) ---
@@ -76,211 +129,270 @@ volatile int32_t global_voc_index = 0;
 
 // --- MQTT ---
 #include "lib/MqttClient.h"
+#include "TelemetryBatcher.h"
+#include "ReportFilter.h"
+#include "Diagnostics.h"
 MqttClient mqttClient;
+TelemetryBatcher telemetry KERNEL_MEMORY(telemetry) (&mqttClient, "apissense/batch"); // Amostras de todos os sensores
+Diagnostics diagnostics(&mqttClient, "apissense/health");   // CPU, pilhas e heap (DIAGNOSTICS_INTERVAL_MS)
+
+// Report by exception: cada metrica so entra no lote quando muda alem da banda
+// morta ou quando fica calada pelo heartbeat. Um degrau grande entre duas
+// amostras seguidas (enxame, colheita, pico de VOC) manda o lote na hora.
+// {banda morta, relativa em milesimos, degrau urgente, heartbeat}
+#define REPORT_HEARTBEAT_MS (15 * 60 * 1000)
+// Passagens acumuladas (entradas + saidas), avaliadas a cada 1 s
+ReportFilter beecountReport({200, 0, 50, REPORT_HEARTBEAT_MS});
+// Uma politica por balanca (a posicao e o "cell" da telemetria), em centigramas,
+// avaliadas a cada 1 s: 50 g ou 1%, degrau de 500 g
+ReportFilter loadcellReport[] = {
+    ReportFilter({5000, 10, 50000, REPORT_HEARTBEAT_MS}),
+};
+#define NUM_LOADCELL_REPORTS (sizeof(loadcellReport) / sizeof(loadcellReport[0]))
+// Indice de VOC (1 Hz): 10 pontos, degrau de 100 pontos, heartbeat menor que o das outras
+ReportFilter vocReport({10, 0, 100, 5 * 60 * 1000});
+
+
+void bee_count_passage(uint8_t channel, bee_passage_t passage, uint32_t transit_us){
+    // Atualiza o contador principal com uma passagem completa
+    if(passage == BEE_PASSAGE_NONE) return;
+
+    // So o incremento fica na secao critica; o printf e feito com a copia
+    taskENTER_CRITICAL();
+    if(passage == BEE_PASSAGE_IN) bee_counter.in++;
+    else bee_counter.out--;
+    bee_counter_t total = bee_counter;
+    taskEXIT_CRITICAL();
+
+    if(passage == BEE_PASSAGE_IN){
+        printf("%s: ENTRADA VALIDA no canal %d (%lu us)! Total de entradas: %d\n", pcTaskGetName(NULL), channel, transit_us, total.in);
+    } else {
+        printf("%s: SAIDA VÁLIDA no canal %d (%lu us)! Total de saidas: %d\n", pcTaskGetName(NULL), channel, transit_us, total.out);
+    }
+}
 
+void bee_push_event(uint8_t expander_id, uint8_t port, uint8_t pin, uint32_t time){
+    gate_event_t event;
+    event.time = time;
+    event.expander = expander_id;
+    event.port = port;
+    event.pin = pin;
+    event.edge = GATE_EDGE_FALL;
 
-void bee_update_queues(MCP23017 expander, QueueHandle_t beeQueue[2][8]){
-    // Funcao para analisar as flags de interrupçao e popular as filas
-    uint8_t flagA = expander.getIntfA();
-    uint8_t flagB = expander.getIntfB();
-    TickType_t current_time = xTaskGetTickCount();
+    if(!gateEvents.push(event))
+        printf("\n%s: [RING] Ring cheio, evento do pino %c%d perdido (total: %lu)\n", pcTaskGetName(NULL), port ? 'B' : 'A', pin, gateEvents.getOverflows());
+}
 
+uint32_t bee_update_queues(bee_expander_t &expander, uint8_t expander_id, uint32_t current_time){
+    // Funcao para analisar as flags de interrupçao e publicar os eventos no ring
+    // current_time e o instante (us) da interrupcao que gerou essas flags
+    // Retorna quantos eventos foram gerados
+    MCP23017 &device = expander.device;
+    // Bordas de descida (sensor ativado) apenas nos pares instalados
+    uint8_t activeA = device.getIntfA() & ~device.getCapA() & expander.gate_mask;
+    uint8_t activeB = device.getIntfB() & ~device.getCapB() & expander.gate_mask;
+    uint32_t events = 0;
+
+    // Percorre so os bits ativos: custo proporcional ao numero de bordas
     // Processa sensores da PORTA A (entrada da colmeia)
-    if(flagA){
-        for(int i = 0; i < 8; i++) {
-            if (flagA & (1 << i)) {
-                // Verifica se foi borda de descida (sensor ativado)
-                if ((expander.getCapA() & (1 << i)) == 0) {
-                    printf("%s: Sensor A%d ativado (ENTRADA DA COLMEIA)\n", pcTaskGetName(NULL), i);
-                    if(xQueueSend(beeQueue[0][i], &current_time, 0) != pdPASS)
-                        printf("\n%s: [QUEUE] Erro ao registrar dado do Expansor 0x%X, pino A%d\n.", pcTaskGetName(NULL), expander.getAddress(), i);
-                }
-            }
-        }
+    while(activeA){
+        int i = __builtin_ctz(activeA);
+        activeA &= activeA - 1;
+        printf("%s: Sensor A%d do expansor 0x%X ativado (ENTRADA DA COLMEIA)\n", pcTaskGetName(NULL), i, device.getAddress());
+        bee_push_event(expander_id, 0, i, current_time);
+        events++;
     }
     // Processa sensores da PORTA B (dentro da colmeia)
-    if(flagB){
-        for(int i = 0; i < 8; i++) {
-            if (flagB & (1 << i)) {
-                if((expander.getCapB() & (1 << i)) == 0){
-                    printf("%s: Sensor B%d ativado (DENTRO DA COLMEIA)\n", pcTaskGetName(NULL), i);
-                    if(xQueueSend(beeQueue[1][i], &current_time, 0) != pdPASS)
-                        printf("\n%s: [QUEUE] Erro ao registrar dado do Expansor 0x%X, pino B%d.\n", pcTaskGetName(NULL), expander.getAddress(), i);
-                }
-            }
-        }
+    while(activeB){
+        int i = __builtin_ctz(activeB);
+        activeB &= activeB - 1;
+        printf("%s: Sensor B%d do expansor 0x%X ativado (DENTRO DA COLMEIA)\n", pcTaskGetName(NULL), i, device.getAddress());
+        bee_push_event(expander_id, 1, i, current_time);
+        events++;
     }
+    return events;
 }
 
 
-// ISR - apenas sinaliza o semáforo de cada expansor
+// ISR generica - registra o instante e sinaliza a task de servico com a mascara dos expansores
 void gpio_irq_handler(uint gpio, uint32_t events){
-    // Aplica um debounce por GPIO
-    // last_gpio e last_int_timestamp no caso, pra impedir que acione varias vezes a interrupcao
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint8_t mask = irq_pin_expanders[gpio];
     
-    if(gpio == EXPANDER1_INT_PIN) {
-        xSemaphoreGiveFromISR(xSemaphoreInt1, &xHigherPriorityTaskWoken);
+    if(mask && xExpanderServiceTask != NULL) {
+        // O INT do MCP23017 fica em nivel baixo ate a leitura do INTCAP, entao
+        // nao ha nova borda (nem novo instante) antes da task consumir esse
+        uint32_t now = time_us_32();
+        for(uint8_t pending = mask; pending; pending &= pending - 1)
+            expander_irq_time[__builtin_ctz(pending)] = now;
+
+        xTaskNotifyFromISR(xExpanderServiceTask, mask, eSetBits, &xHigherPriorityTaskWoken);
         portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
     }
 }
 
-void vExpander1(void *params) {
-    // Essa funcao só serve pra capturar as interrupcoes e adicionar valores nas filas
-    // Entao ela só precisa dessa parte de checar o semaforo da propria interrupcao no while(true)
-    // O tratamento das filas fica para outra task
-
-    // Inicializa as filas dos pares de sensores
-    // beeQueue[PORT][CANAL], uma fila para cada canal (Entrada/Saida)
-    for(int i = 0; i < NUM_CHANNELS_MCP; i++) {
-        for(int j = 0; j<2; j++){
-            beeQueue1[j][i] = xQueueCreate(BEE_QUEUE_LENGTH, sizeof(TickType_t));
-            if (beeQueue1[j][i] == NULL) {
-                printf("%s: Erro ao criar a fila para o sensor %d do port %d do expansor %d!\n", pcTaskGetName(NULL), i, j);
-            }
-        }
+void vExpanderService(void *params) {
+    // Task unica para todos os expansores da tabela: só captura as interrupcoes e
+    // publica os eventos no ring. O casamento dos eventos fica para a vBeeMatcherTask
+    uint32_t pending;
+
+    for(uint8_t i = 0; i < NUM_EXPANDERS; i++){
+        MCP23017 &device = expanders[i].device;
+        device.init();
+        // Só gera interrupcao nos pares instalados (GPINTENA e GPINTENB numa escrita)
+        uint8_t gpinten[2] = {expanders[i].gate_mask, expanders[i].gate_mask};
+        device.writeRegisters(MCP_GPINTENA, gpinten, 2);
+        // Limpa qualquer interrupção pendente
+        device.handle_flags();
+
+        irq_pin_expanders[device.getInterruptPin()] |= (1 << i);
+        gpio_set_irq_enabled_with_callback(device.getInterruptPin(), GPIO_IRQ_EDGE_FALL, true, &gpio_irq_handler);
     }
-    
-    // Inicializando o semáforo para a interrupçao desse expansor
-    xSemaphoreInt1 = xSemaphoreCreateBinary();
-    // Limpa qualquer interrupção pendente
-    expander1.handle_flags();
-
-    gpio_set_irq_enabled_with_callback(expander1.getInterruptPin(), GPIO_IRQ_EDGE_FALL, true, &gpio_irq_handler);
 
     while (true) {
-        // Aguarda sinal de interrupção
-        if(xSemaphoreTake(xSemaphoreInt1, portMAX_DELAY) == pdTRUE) {
-            expander1.handle_flags();
-            bee_update_queues(expander1, beeQueue1);
+        // Aguarda sinal de interrupção: a notificacao traz (e zera) os bits dos expansores pendentes
+        if(xTaskNotifyWait(0, 0xFFFFFFFF, &pending, portMAX_DELAY) == pdTRUE) {
+            uint32_t events = 0;
+            while(pending){
+                uint8_t i = __builtin_ctz(pending);
+                pending &= pending - 1;
+                // Le o instante antes de limpar a interrupcao no expansor
+                uint32_t irq_time = expander_irq_time[i];
+                expanders[i].device.handle_flags();
+                events += bee_update_queues(expanders[i], i, irq_time);
+            }
+            if(events && xBeeMatcherTask != NULL)
+                xTaskNotifyGive(xBeeMatcherTask);
         }
     }
 }
 
+void vBeeMatcherTask(void *params){
+    // Consome o ring de eventos e alimenta a maquina de estados dos canais.
+    // Só acorda com novos eventos ou quando algum evento pendente expira,
+    // entao com a colmeia parada nao ha nenhum processamento
+    gate_event_t event;
+    uint32_t transit_us;
 
-
-
-void consume_individual_expander_queue(QueueHandle_t beeQueue[2][8]){
-    TickType_t entry_time;
-    TickType_t exit_time;
-
-    // Iteraqndo pelos 8 canais do expansor
-    for(int channel = 0; channel < NUM_CHANNELS_MCP; channel++){
-        // Verificando os novos eventos de cada fila do canal atual
-        // O xQueuePeek pega o dado sem consumir a fila
-        if(xQueuePeek(beeQueue[0][channel], &entry_time, 0) == pdPASS && xQueuePeek(beeQueue[1][channel], &exit_time, 0) == pdPASS){
-            // ENTRADA (Evento A acontece antes do evento B)
-            if(entry_time < exit_time){
-                // Dentro do timeout?
-                if((exit_time - entry_time) <= pdMS_TO_TICKS(BEE_PASSAGE_WINDOW_MS)){
-                    // Entrada válida
-                    if(xSemaphoreTake(xMutexCounter, portMAX_DELAY) == pdTRUE){
-                        bee_counter.in++;
-                        printf("%s: ENTRADA VALIDA no canal %d! Total de entradas: %d\n", pcTaskGetName(NULL), channel, bee_counter.in);
-                        xSemaphoreGive(xMutexCounter);
-                    }
-                    // Removendo os eventos processados
-                    xQueueReceive(beeQueue[0][channel], &entry_time, 0);
-                    xQueueReceive(beeQueue[1][channel], &exit_time, 0);
-                }
-                else{
-                    // O evento de entrada é muito antigo, já descarta o A
-                    // printf("[TIMEOUT] Canal A%d.\n", channel);
-                    xQueueReceive(beeQueue[0][channel], &entry_time, 0);
-                }
-            }
-        
-            // SAIDA (Evento B acontece antes do evento A)
-            else{ // exit_time < entry_time
-                // Dentro do timeout?
-                if((entry_time - exit_time) <= pdMS_TO_TICKS(BEE_PASSAGE_WINDOW_MS)){
-                    // Saida valida
-                    if(xSemaphoreTake(xMutexCounter, portMAX_DELAY) == pdTRUE){
-                        bee_counter.out--;
-                        printf("%s: SAIDA VÁLIDA no canal %d! Total de saidas: %d\n", pcTaskGetName(NULL), channel, bee_counter.out);
-                        xSemaphoreGive(xMutexCounter);
-                    }
-                    // Removendo os eventos processados
-                    xQueueReceive(beeQueue[0][channel], &entry_time, 0);
-                    xQueueReceive(beeQueue[1][channel], &exit_time, 0);
-                }
-                else{
-                    // Evento de entrada muito antigo, descarta B
-                    // printf("[FILA - TIMEOUT] Canal B%d.\n", channel);
-                    xQueueReceive(beeQueue[1][channel], &exit_time, 0);
-                }
-            }
+    while(true){
+        // Timer unico: espera ate a proxima expiracao, ou para sempre se nada estiver pendente
+        TickType_t timeout = portMAX_DELAY;
+        uint32_t deadline;
+        if(beeMatcher.nextDeadline(&deadline)){
+            int32_t remaining_us = (int32_t)(deadline - time_us_32());
+            // Arredonda para cima para nao acordar antes do prazo
+            timeout = (remaining_us > 0) ? pdMS_TO_TICKS((remaining_us + 999) / 1000) : 0;
         }
+        ulTaskNotifyTake(pdTRUE, timeout);
 
-        // Se nao tiver nenhum par pra comparar limpa os eventos da fila
-        else{
-            TickType_t current_time = xTaskGetTickCount();
-            // Evento de entrada antigo
-            if(xQueuePeek(beeQueue[0][channel], &entry_time, 0) == pdPASS){
-                if((current_time - entry_time) > pdMS_TO_TICKS(BEE_EVENT_TIMEOUT_MS)){
-                    // printf("[FILA - TIMEOUT] Limpando evento de entrada do canal A%d\n", channel);
-                    xQueueReceive(beeQueue[0][channel], &entry_time, 0); // Remove da fila
-                }
-            }
-            // Evento de saida antigo
-            if(xQueuePeek(beeQueue[1][channel], &exit_time, 0) == pdPASS){
-                if((current_time - exit_time) > pdMS_TO_TICKS(BEE_EVENT_TIMEOUT_MS)){
-                    // printf("[FILA - TIMEOUT] Limpando evento de saida do canal B%d\n", channel);
-                    xQueueReceive(beeQueue[1][channel], &exit_time, 0); // Remove da fila
-                }
-            }
+        while(gateEvents.pop(&event)){
+            uint8_t channel = event.expander * NUM_CHANNELS_MCP + event.pin;
+            bee_gate_side_t side = event.port ? BEE_GATE_EXIT : BEE_GATE_ENTRY;
+            bee_passage_t passage = beeMatcher.onEdge(channel, side, event.time, &transit_us);
+            bee_count_passage(channel, passage, transit_us);
         }
+        beeMatcher.expire(time_us_32());
     }
 }
 
-void vBeeConsumeQueuesTask(void *params){
-    // Task para limpar as filas de cada expansor separadamente
-    while(true){
-        consume_individual_expander_queue(beeQueue1);
-
-        vTaskDelay(pdMS_TO_TICKS(50));
-    }
-}
 
 
+// Job opcional para exibir estatísticas (10 s)
+void statisticsInit(void *params){
+    uint8_t busy[configNUMBER_OF_CORES];
+    coreLoad.begin();
+    coreLoad.sample(busy);
+}
 
-// Task opcional para exibir estatísticas
-void vStatistics(void *params) {
-    while(true) {
-        vTaskDelay(pdMS_TO_TICKS(10000)); // A cada 10 segundos
-        
-        if(xSemaphoreTake(xMutexCounter, portMAX_DELAY) == pdTRUE) {
-            printf("\n=== ESTATISTICAS ===\n");
-            printf("Total de abelhas ENTRADA: %d\n", bee_counter.in);
-            printf("Total de abelhas SAIDA: %d\n", bee_counter.out);
-            printf("====================\n\n");
-            xSemaphoreGive(xMutexCounter);
-        }
+void statisticsJob(void *params) {
+    uint8_t busy[configNUMBER_OF_CORES];
+    bee_counter_t total = bee_counter_get();
+    printf("\n=== ESTATISTICAS ===\n");
+    printf("Total de abelhas ENTRADA: %d\n", total.in);
+    printf("Total de abelhas SAIDA: %d\n", total.out);
+    printf("Eventos perdidos (ring/pool): %lu/%lu\n", gateEvents.getOverflows(), beeMatcher.getDropped());
+    for(uint8_t i = 0; i < NUM_EXPANDERS; i++)
+        printf("Expansor 0x%X: atendimento %lu us (max %lu us)\n", expanders[i].device.getAddress(), expanders[i].device.getServiceTime(), expanders[i].device.getServiceTimeMax());
+    if(coreLoad.sample(busy)){
+        for(uint8_t i = 0; i < configNUMBER_OF_CORES; i++)
+            printf("Nucleo %u: %u%% ocupado\n", i, busy[i]);
     }
+    low_power_stats_t sleep;
+    low_power_get_stats(&sleep);
+    printf("Sono (tickless): %llu ms em %lu entradas, %lu desistencias\n", sleep.sleep_us / 1000,
+           sleep.sleeps, sleep.aborted);
+    sensorScheduler.printStats();
+    reportScheduler.printStats();
+    printf("====================\n\n");
 }
 
 
-// Task para as Loadcells
-void vLoadCellsTask(void *params){
+// Jobs das Loadcells (2 s)
+void loadCellsInit(void *params){
     PIO pio = pio0;
-    uint offset = pio_add_program(pio, &hx711_program);
+    uint offset = pio_add_program(pio, &hx711_stream_program);
     int sm = pio_claim_unused_sm(pio, true);
 
-    loadcell1.begin(pio, sm, offset);
+    // Modo continuo: PIO + DMA capturam todas as conversoes, o job so le o ring
+    loadcell1.beginStream(pio, sm, offset);
     loadcell1.set_scale(loadcell1_scale);
     loadcell1.tare(20); 
+}
 
-    while(true){
-        loadcell1.get_units(10);
-        printf("%s: Peso lido: %.2f g\n", pcTaskGetName(NULL), loadcell1.get_last_weight());
-        vTaskDelay(pdMS_TO_TICKS(2000)); 
-        // loadcell1.calbirate_manual(224.0f, 20);
+void loadCellsJob(void *params){
+    loadcell1.get_units(10);
+    if(loadcell1.is_stale()){
+        printf("LoadCells: HX711 sem dados ha mais de %d ms\n", HX711_STALE_TIMEOUT_MS);
+    } else {
+        printf("LoadCells: Peso lido: %.2f g (%.1f amostras/s)\n", loadcell1.get_last_weight(), loadcell1.get_samples_per_second());
     }
+    // loadcell1.calbirate_manual(224.0f, 20);
 }
 
-void vVOCSensorTask(void *params){
-    GasIndexAlgorithmParams voc_params;
+// Checkpoint do estado do algoritmo de VOC na flash
+#define VOC_STATE_SAVE_INTERVAL_MIN 10  // Intervalo entre gravacoes
+#define VOC_STATE_MAX_AGE_MIN 60        // Estado mais velho que isso e descartado
+#define VOC_STATE_AGE_WAIT_MIN 10       // Espera maxima pelo SNTP para conferir a idade
+#define VOC_STATE_LEARNING_MIN (3 * 60) // Aprendizado minimo antes de salvar (recomendacao da Sensirion)
+#define VOC_ALARM_INDEX 400             // Acima disso o lote e enviado na hora
+// Leitura depois do inicio da medicao: conversao do SGP40 e um slot de folga
+#define VOC_READ_PHASE_MS (SGP40_MEASURE_RAW_SIGNAL_DURATION_US / 1000 + SENSOR_SCHEDULER_SLOT_MS)
+
+// Parâmetros fixos de compensação (50% RH, 25°C)
+// Discutir sobre injetar valores reais do sensor DHT aqui
+#define VOC_DEFAULT_RH 0x8000
+#define VOC_DEFAULT_T 0x6666
+
+VocStateStore vocStateStore;
+
+// Estado do VOC entre os jobs (todos no worker do sensorScheduler)
+static GasIndexAlgorithmParams voc_params;
+static uint32_t voc_saved_at = 0;
+static bool voc_age_checked = true;
+static uint32_t voc_learned_min = 0; // Minutos de aprendizado acumulado
+static uint32_t voc_seconds = 0;
+static int16_t voc_start_error = 0;  // Resultado do inicio da medicao deste segundo
+// Amostras (1 Hz) que passam pelo vocReport vao para o lote da telemetria
+static telemetry_message_t voc_sample = {};
+
+void vocInit(void *params){
     GasIndexAlgorithm_init(&voc_params, GasIndexAlgorithm_ALGORITHM_TYPE_VOC);
+    voc_sample.type = TELEMETRY_VOC;
+
+    // Retoma o aprendizado salvo: a idade so pode ser conferida quando o SNTP
+    // sincronizar, ate la o estado restaurado ja e usado. Sem hora na gravacao
+    // nao ha como saber a idade, entao o registro nao vale
+    bool restored = vocStateStore.restore(&voc_params, &voc_saved_at);
+    if (restored && voc_saved_at == 0) {
+        printf("[VOC] Estado salvo sem hora, reiniciando o aprendizado\n");
+        GasIndexAlgorithm_init(&voc_params, GasIndexAlgorithm_ALGORITHM_TYPE_VOC);
+        restored = false;
+    }
+    voc_age_checked = !restored;
+    if (restored) {
+        printf("[VOC] Estado do algoritmo restaurado da flash\n");
+    }
+    voc_learned_min = restored ? VOC_STATE_LEARNING_MIN : 0;
 
     uint16_t serial_number[3];
     int16_t error = sgp40_get_serial_number(serial_number, 3);
@@ -290,100 +402,170 @@ void vVOCSensorTask(void *params){
     } else {
         printf("SGP40 Iniciado. Serial: %04x%04x%04x\n", serial_number[0], serial_number[1], serial_number[2]);
     }
+}
 
-    // Parâmetros fixos de compensação (50% RH, 25°C)
-    // Discutir sobre injetar valores reais do sensor DHT aqui
-    uint16_t default_rh = 0x8000;
-    uint16_t default_t = 0x6666;
+// Medicao em duas fases: o worker fica livre para os outros jobs durante os
+// 30 ms de conversao do SGP40
+void vocStartJob(void *params){
+    voc_start_error = sgp40_start_measure_raw_signal(VOC_DEFAULT_RH, VOC_DEFAULT_T);
+}
+
+void vocReadJob(void *params){
     uint16_t sraw_voc = 0;
     int32_t voc_index = 0;
+    int16_t error = voc_start_error;
+    if (!error) {
+        error = sgp40_read_measure_raw_signal(&sraw_voc);
+    }
+    if (error) {
+        printf("SGP40: Erro de leitura (%d)\n", error);
+    } else {
+        bool was_alarm = global_voc_index >= VOC_ALARM_INDEX;
+        GasIndexAlgorithm_process(&voc_params, sraw_voc, &voc_index); // Output
+        global_voc_index = voc_index;
+
+        // Entrar no alarme sempre vai na hora, mesmo dentro da banda morta
+        bool alarm = !was_alarm && voc_index >= VOC_ALARM_INDEX;
+        report_decision_t decision = vocReport.check(voc_index, to_ms_since_boot(get_absolute_time()));
+        if (alarm || decision != REPORT_SKIP) {
+            voc_sample.data.voc.index = voc_index;
+            telemetry.add(&voc_sample, alarm || decision == REPORT_URGENT);
+        }
+    }
 
-    TickType_t xLastWakeTime;
-    const TickType_t xFrequency = pdMS_TO_TICKS(1000);
+    uint32_t now;
+    if (!voc_age_checked && wall_clock_now(&now)) {
+        voc_age_checked = true;
+        if (now - voc_saved_at > VOC_STATE_MAX_AGE_MIN * 60) {
+            printf("[VOC] Estado salvo muito antigo (%lu min), reiniciando o aprendizado\n", (now - voc_saved_at) / 60);
+            GasIndexAlgorithm_init(&voc_params, GasIndexAlgorithm_ALGORITHM_TYPE_VOC);
+            voc_learned_min = 0;
+        }
+    } else if (!voc_age_checked && voc_learned_min >= VOC_STATE_LEARNING_MIN + VOC_STATE_AGE_WAIT_MIN) {
+        // O SNTP nao sincronizou a tempo: a idade nunca vai ser conferida
+        voc_age_checked = true;
+        printf("[VOC] Sem hora real em %d min, descartando o estado restaurado\n", VOC_STATE_AGE_WAIT_MIN);
+        GasIndexAlgorithm_init(&voc_params, GasIndexAlgorithm_ALGORITHM_TYPE_VOC);
+        voc_learned_min = 0;
+    }
 
-    // Inicializa o tempo para garantir 1s exato entre execuções
-    xLastWakeTime = xTaskGetTickCount();
+    if (++voc_seconds < 60) return;
+    voc_seconds = 0;
+    voc_learned_min++;
+    // Grava so depois do aprendizado inicial e com hora real: um registro sem
+    // hora seria descartado na proxima partida
+    if (voc_learned_min >= VOC_STATE_LEARNING_MIN && voc_learned_min % VOC_STATE_SAVE_INTERVAL_MIN == 0 &&
+        wall_clock_now(&now)) {
+        vocStateStore.save(&voc_params, now);
+    }
+}
 
-    while (true) {
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
-        error = sgp40_measure_raw_signal(default_rh, default_t, &sraw_voc);
-        if (error) {
-            printf("SGP40: Erro de leitura (%d)\n", error);
-        } else {
-            GasIndexAlgorithm_process(&voc_params, sraw_voc, &voc_index); // Output
-            global_voc_index = voc_index;
+// Gramas -> centesimos de grama, arredondado
+static int32_t toCentigrams(float grams){
+    return (int32_t)(grams * 100.0f + (grams < 0 ? -0.5f : 0.5f));
+}
+
+// Job para enviar os dados via MQTT (1 s, depois das amostras do mesmo
+// segundo): avalia as metricas, poe no lote so as que a politica de envio pede
+// e envia os lotes que passaram da idade maxima
+void reportJob(void *params){
+    static telemetry_message_t beecount = {TELEMETRY_BEECOUNT};
+    static telemetry_message_t loadcell = {TELEMETRY_LOADCELL};
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    bool urgent = false;
+
+    // Fluxo de abelhas: a politica olha o total de passagens (out e negativo)
+    bee_counter_t total = bee_counter_get();
+    beecount.data.beecount.in = total.in;
+    beecount.data.beecount.out = total.out;
+    report_decision_t decision = beecountReport.check(beecount.data.beecount.in - beecount.data.beecount.out, now);
+    if(decision != REPORT_SKIP){
+        telemetry.add(&beecount);
+        urgent |= decision == REPORT_URGENT;
+    }
+
+    // Peso das balancas
+    for(uint32_t i = 0; i < NUM_LOADCELL_REPORTS; i++){
+        loadcell.data.loadcell.cell = (uint8_t)i;
+        loadcell.data.loadcell.raw_cg = toCentigrams(24.5f);
+        loadcell.data.loadcell.tare_cg = toCentigrams(0.9f);
+        decision = loadcellReport[i].check(loadcell.data.loadcell.raw_cg - loadcell.data.loadcell.tare_cg, now);
+        if(decision != REPORT_SKIP){
+            telemetry.add(&loadcell);
+            urgent |= decision == REPORT_URGENT;
         }
     }
+
+    // Um evento leva junto o que ja estava no lote
+    if(urgent) telemetry.flush();
+    else telemetry.poll();
 }
 
-// Task para enviar os dados via MQTT
-void vMqttReportTask(void *params){
-    // Buffer para criar o JSON
-    char json_payload[128]; 
+// Saude do firmware (DIAGNOSTICS_INTERVAL_MS): publish proprio, fora do lote
+void healthInit(void *params){
+    diagnostics.begin();
+}
 
-    while(true){
-        vTaskDelay(pdMS_TO_TICKS(60*1000)); // 1 minuto
-
-        // Coloca proteções com Mutex caso alguns valores saiam bugados, pelo que vi só é thread safe a leitura de variaveis de 32 bits
-
-        // --- Envio dos dados de sensores nos tópicos
-        // Fluxo de abelhas
-        snprintf(json_payload, sizeof(json_payload), 
-                 "{\"in\": %d, \"out\": %d}", 
-                 bee_counter.in, bee_counter.out);
-        mqttClient.publish("apissense/beecount", json_payload);
-
-        // Peso da balanca
-        snprintf(json_payload, sizeof(json_payload), 
-                 "{\"raw\": %.2f, \"tare\": %.2f}", 
-                 24.5, 0.9);
-        mqttClient.publish("apissense/loadcell1", json_payload);
-
-        snprintf(json_payload, sizeof(json_payload), 
-                 "{\"index\": %ld}", 
-                 global_voc_index);    
-        mqttClient.publish("apissense/voc", json_payload);
-    }
+void healthJob(void *params){
+    diagnostics.publish();
 }
 
 
+// Pilhas e blocos de controle das tasks (KernelMemory.h), por subsistema. As
+// amostragens periodicas ficam nos workers dos schedulers
+KernelTask<2048> mqttCoreTask KERNEL_MEMORY(radio);
+KernelTask<configMINIMAL_STACK_SIZE + 256> beeMatcherTask KERNEL_MEMORY(sensors);
+KernelTask<configMINIMAL_STACK_SIZE + 256> expanderServiceTask KERNEL_MEMORY(sensors);
+
 int main(){
     stdio_init_all();
-    sensirion_i2c_hal_init();
-    
+
     bee_counter.in = 0;
     bee_counter.out = 0;
 
-    // Iniciando o I2C 
-    i2c_init(I2C_PORT, 400 * 1000);
-    gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
-    gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
-    gpio_pull_up(I2C_SDA);
-    gpio_pull_up(I2C_SCL);
-
-    // Iniciando os expansores (MCP23017)
-    // expander1.init();
+    // Iniciando o I2C: a task do motor e dona do barramento e fica acima das
+    // tasks dos sensores, para nao atrasar o atendimento dos expansores.
+    // Fica no nucleo dos sensores, junto com a IRQ do I2C
+    if(!i2cBus.begin(5, CORE_AFFINITY_SENSORS)){
+        printf("Falha ao iniciar o barramento I2C!\n");
+    }
+    sensirion_i2c_hal_init();
 
-    // // Mutex para acesso do contador de abelhas
-    // xMutexCounter = xSemaphoreCreateMutex();
+    // Lote da telemetria: usado pelas tasks dos sensores mesmo sem MQTT
+    telemetry.begin();
 
     // // Cria as tasks
-    // Inicializa o MQTT
+    // Inicializa o MQTT. O cyw43_arch_init roda aqui, no nucleo 0: a IRQ de
+    // background do cyw43 (lwIP, TLS) fica no nucleo do radio
     if (!mqttClient.begin()) {
         printf("Falha ao iniciar MQTT!\n");
     } else {
-        xTaskCreate(MqttClient::taskImpl, "MqttCore", 2048, &mqttClient, 2, NULL); // Task interna para conexão do MQTT
-        xTaskCreate(vMqttReportTask, "MqttReport", 2048, NULL, 2, NULL); // Task externa para gerar payloads e enviar dados para o broker
+        mqttCoreTask.create(MqttClient::taskImpl, "MqttCore", &mqttClient, 2, NULL, CORE_AFFINITY_RADIO); // Task interna para conexão do MQTT
+        // Jobs externos para gerar payloads e enviar dados para o broker
+        reportScheduler.add("Report", 1000, 100, reportJob);
+        reportScheduler.add("Health", DIAGNOSTICS_INTERVAL_MS, 200, healthJob, healthInit);
+        reportScheduler.begin("MqttReport", 2, CORE_AFFINITY_RADIO);
     }
 
-    // xTaskCreate(vExpander1, "vExpander1", configMINIMAL_STACK_SIZE + 256, NULL, 4, NULL);
-    // xTaskCreate(vBeeConsumeQueuesTask, "vBeeConsumeQueuesTask", configMINIMAL_STACK_SIZE + 256, NULL, 4, NULL);
-    // xTaskCreate(vLoadCellsTask, "vLoadCellsTask", configMINIMAL_STACK_SIZE + 256, NULL, 4, NULL);
-    xTaskCreate(vVOCSensorTask, "vVOCSensorTask", configMINIMAL_STACK_SIZE + 256, NULL, 4, NULL);
-    
-    // Task opcional para debug
-    // xTaskCreate(vStatistics, "Statistics", configMINIMAL_STACK_SIZE + 128, NULL, 2, NULL);
-    
+    // Sensores no nucleo 1: a vExpanderService habilita a IRQ dos MCP23017 la
+    // beeMatcherTask.create(vBeeMatcherTask, "vBeeMatcherTask", NULL, 4, &xBeeMatcherTask, CORE_AFFINITY_SENSORS);
+    // expanderServiceTask.create(vExpanderService, "vExpanderService", NULL, 4, &xExpanderServiceTask, CORE_AFFINITY_SENSORS);
+
+    // Jobs periodicos dos sensores: mesma ordem de cadastro em cada instante,
+    // os de 1 s e 2 s amostram juntos nos segundos pares
+    // sensorScheduler.add("LoadCells", 2000, 0, loadCellsJob, loadCellsInit);
+    sensorScheduler.add("VocStart", 1000, 0, vocStartJob, vocInit);
+    sensorScheduler.add("VocRead", 1000, VOC_READ_PHASE_MS, vocReadJob);
+    // Job opcional para debug (inclui a ocupacao de cada nucleo e o jitter dos jobs)
+    // sensorScheduler.add("Statistics", 10000, 300, statisticsJob, statisticsInit);
+    sensorScheduler.begin("Sensors", 4, CORE_AFFINITY_SENSORS);
+
+    // Mapa da memoria dos objetos do kernel e o que sobrou no heap
+    kernel_memory_print();
+
+    // Tickless idle (FREERTOS_TICKLESS): alarme de despertar e clocks do sono
+    low_power_begin();
+
     vTaskStartScheduler();
     panic_unsupported();
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+# Relatorio da memoria estatica por subsistema, rodado depois do link.
+# Soma as secoes .bss.kmem.<subsistema>.* do mapa do link (KernelMemory.h) e
+# falha o build quando um subsistema passa do orcamento.
+#   MAP_FILE     - mapa gerado pelo linker (ApiSSense.elf.map)
+#   KMEM_BUDGETS - orcamentos em bytes: "kernel:7168,radio:17408,..."
+
+cmake_minimum_required(VERSION 3.13)
+
+if(NOT EXISTS "${MAP_FILE}")
+    message(FATAL_ERROR "Mapa do link nao encontrado: ${MAP_FILE}")
+endif()
+
+file(READ "${MAP_FILE}" map)
+# Antes disso vem a lista de secoes descartadas pelo --gc-sections
+string(FIND "${map}" "Linker script and memory map" start)
+if(start LESS 0)
+    message(FATAL_ERROR "Formato de mapa desconhecido: ${MAP_FILE}")
+endif()
+string(SUBSTRING "${map}" ${start} -1 map)
+
+# Nome longo: o endereco e o tamanho vem na linha de baixo
+string(REGEX MATCHALL "\n \\.bss\\.kmem\\.[a-z0-9_]+\\.[^ \n]+[ \n]+0x[0-9a-f]+[ ]+0x[0-9a-f]+" entries "${map}")
+
+set(subsystems "")
+foreach(entry IN LISTS entries)
+    string(REGEX MATCH "\\.bss\\.kmem\\.([a-z0-9_]+)\\.[^ \n]+[ \n]+0x[0-9a-f]+[ ]+(0x[0-9a-f]+)" _ "${entry}")
+    set(sub "${CMAKE_MATCH_1}")
+    if(NOT sub IN_LIST subsystems)
+        list(APPEND subsystems "${sub}")
+        set(used_${sub} 0)
+    endif()
+    math(EXPR used_${sub} "${used_${sub}} + ${CMAKE_MATCH_2}")
+endforeach()
+
+string(REPLACE "," ";" budgets "${KMEM_BUDGETS}")
+foreach(budget IN LISTS budgets)
+    string(REPLACE ":" ";" budget "${budget}")
+    list(GET budget 0 sub)
+    list(GET budget 1 bytes)
+    set(budget_${sub} ${bytes})
+    if(NOT sub IN_LIST subsystems)
+        list(APPEND subsystems "${sub}")
+        set(used_${sub} 0)
+    endif()
+endforeach()
+
+list(SORT subsystems)
+set(total 0)
+set(over "")
+message("Memoria estatica por subsistema (usado / orcamento, bytes):")
+foreach(sub IN LISTS subsystems)
+    math(EXPR total "${total} + ${used_${sub}}")
+    if(NOT DEFINED budget_${sub})
+        message("  ${sub}: ${used_${sub}} / sem orcamento")
+        list(APPEND over "${sub} (sem orcamento)")
+    else()
+        message("  ${sub}: ${used_${sub}} / ${budget_${sub}}")
+        if(used_${sub} GREATER budget_${sub})
+            list(APPEND over "${sub}")
+        endif()
+    endif()
+endforeach()
+message("  total: ${total}")
+
+if(over)
+    string(REPLACE ";" ", " over "${over}")
+    message(FATAL_ERROR "Orcamento de RAM estourado: ${over}")
+endif()
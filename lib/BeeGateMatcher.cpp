@@ -0,0 +1,133 @@
+#include "BeeGateMatcher.h"
+
+static_assert(BEE_GATE_POOL_SIZE < BEE_GATE_NIL, "BEE_GATE_POOL_SIZE precisa caber em uint8_t");
+static_assert(BEE_GATE_MAX_CHANNELS <= 256, "BEE_GATE_MAX_CHANNELS precisa caber em uint8_t");
+
+BeeGateMatcher::BeeGateMatcher(uint32_t window) : _window(window){
+    reset();
+}
+
+void BeeGateMatcher::reset(){
+    // Encadeia todos os nos na lista livre
+    for(int i = 0; i < BEE_GATE_POOL_SIZE; i++){
+        _pool[i].next = (i + 1 < BEE_GATE_POOL_SIZE) ? i + 1 : BEE_GATE_NIL;
+    }
+    _free = 0;
+    _oldest = BEE_GATE_NIL;
+    _newest = BEE_GATE_NIL;
+
+    for(int i = 0; i < BEE_GATE_MAX_CHANNELS; i++){
+        _channels[i].head = BEE_GATE_NIL;
+        _channels[i].tail = BEE_GATE_NIL;
+        _channels[i].side = BEE_GATE_ENTRY;
+    }
+    _dropped = 0;
+    _expired = 0;
+}
+
+void BeeGateMatcher::push(uint8_t channel, uint32_t time){
+    if(_free == BEE_GATE_NIL){
+        _dropped++;
+        return;
+    }
+    uint8_t node = _free;
+    _free = _pool[node].next;
+
+    _pool[node].time = time;
+    _pool[node].channel = channel;
+    _pool[node].next_channel = BEE_GATE_NIL;
+
+    // Final da fila do canal
+    channel_t *ch = &_channels[channel];
+    if(ch->tail == BEE_GATE_NIL) ch->head = node;
+    else _pool[ch->tail].next_channel = node;
+    ch->tail = node;
+
+    // Lista global ordenada por tempo. Cada canal vem de um expansor so, entao
+    // chega em ordem; entre expansores a ordem e a do atendimento, nao a da IRQ.
+    // Procura a posicao a partir do final: quase sempre e o proprio final
+    uint8_t prev = _newest;
+    while(prev != BEE_GATE_NIL && (int32_t)(time - _pool[prev].time) < 0) prev = _pool[prev].prev;
+    _pool[node].prev = prev;
+    _pool[node].next = (prev == BEE_GATE_NIL) ? _oldest : _pool[prev].next;
+    if(prev == BEE_GATE_NIL) _oldest = node;
+    else _pool[prev].next = node;
+    if(_pool[node].next == BEE_GATE_NIL) _newest = node;
+    else _pool[_pool[node].next].prev = node;
+}
+
+void BeeGateMatcher::popHead(uint8_t channel){
+    channel_t *ch = &_channels[channel];
+    uint8_t node = ch->head;
+
+    ch->head = _pool[node].next_channel;
+    if(ch->head == BEE_GATE_NIL) ch->tail = BEE_GATE_NIL;
+
+    // Remove da lista global
+    if(_pool[node].prev == BEE_GATE_NIL) _oldest = _pool[node].next;
+    else _pool[_pool[node].prev].next = _pool[node].next;
+    if(_pool[node].next == BEE_GATE_NIL) _newest = _pool[node].prev;
+    else _pool[_pool[node].next].prev = _pool[node].prev;
+
+    // Devolve para a lista livre
+    _pool[node].next = _free;
+    _free = node;
+}
+
+bool BeeGateMatcher::outsideWindow(uint32_t time, uint32_t now){
+    // Diferenca com sinal: segura no overflow do contador e tolera eventos
+    // levemente fora de ordem (diferenca negativa conta como dentro da janela)
+    return (int32_t)(now - time) > (int32_t)_window;
+}
+
+bee_passage_t BeeGateMatcher::onEdge(uint8_t channel, bee_gate_side_t side, uint32_t time, uint32_t *transit){
+    if(channel >= BEE_GATE_MAX_CHANNELS) return BEE_PASSAGE_NONE;
+    channel_t *ch = &_channels[channel];
+
+    // Evento do lado oposto ao que esta pendente: tenta fechar a passagem
+    if(ch->head != BEE_GATE_NIL && ch->side != side){
+        // Eventos fora da janela nunca mais vao casar, descarta
+        while(ch->head != BEE_GATE_NIL && outsideWindow(_pool[ch->head].time, time)){
+            popHead(channel);
+            _expired++;
+        }
+        if(ch->head != BEE_GATE_NIL){
+            if(transit != NULL){
+                int32_t elapsed = (int32_t)(time - _pool[ch->head].time);
+                *transit = (elapsed > 0) ? (uint32_t)elapsed : 0;
+            }
+            popHead(channel);
+            return (side == BEE_GATE_EXIT) ? BEE_PASSAGE_IN : BEE_PASSAGE_OUT;
+        }
+    }
+
+    // Canal ocioso ou mesmo lado: o evento fica aguardando o par
+    if(ch->head == BEE_GATE_NIL) ch->side = side;
+    push(channel, time);
+    return BEE_PASSAGE_NONE;
+}
+
+uint32_t BeeGateMatcher::expire(uint32_t now){
+    uint32_t count = 0;
+    // O mais antigo da lista global sempre e a cabeca da fila do seu canal
+    while(_oldest != BEE_GATE_NIL && outsideWindow(_pool[_oldest].time, now)){
+        popHead(_pool[_oldest].channel);
+        count++;
+    }
+    _expired += count;
+    return count;
+}
+
+bool BeeGateMatcher::nextDeadline(uint32_t *deadline){
+    if(_oldest == BEE_GATE_NIL) return false;
+    *deadline = _pool[_oldest].time + _window + 1;
+    return true;
+}
+
+uint32_t BeeGateMatcher::getDropped(){
+    return _dropped;
+}
+
+uint32_t BeeGateMatcher::getExpired(){
+    return _expired;
+}
@@ -0,0 +1,83 @@
+#ifndef BEEGATEMATCHER_H
+#define BEEGATEMATCHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Quantidade de canais (pares de sensores entrada/saida) acompanhados
+#ifndef BEE_GATE_MAX_CHANNELS
+#define BEE_GATE_MAX_CHANNELS 64 // 8 expansores x 8 pares
+#endif
+// Eventos aguardando par, somando todos os canais (compartilhados)
+#ifndef BEE_GATE_POOL_SIZE
+#define BEE_GATE_POOL_SIZE 128
+#endif
+
+#define BEE_GATE_NIL 0xFF // Indice invalido nas listas do pool
+
+typedef enum{
+    BEE_GATE_ENTRY = 0, // Sensor do PORTA (entrada da colmeia)
+    BEE_GATE_EXIT = 1   // Sensor do PORTB (dentro da colmeia)
+} bee_gate_side_t;
+
+typedef enum{
+    BEE_PASSAGE_NONE = 0, // Evento ficou pendente aguardando o par
+    BEE_PASSAGE_IN,       // Passagem completa ENTRY -> EXIT
+    BEE_PASSAGE_OUT       // Passagem completa EXIT -> ENTRY
+} bee_passage_t;
+
+// Maquina de estados por canal que casa os eventos de entrada/saida das abelhas.
+// Cada canal esta ocioso ou guarda uma fila FIFO de eventos de um mesmo lado
+// (o lado que disparou primeiro). Um evento do lado oposto dentro da janela
+// fecha a passagem com o evento mais antigo da fila.
+//
+// Todos os eventos pendentes tambem ficam numa lista global ordenada por tempo,
+// entao a expiracao olha apenas a cabeca dessa lista: O(1) por evento e nenhum
+// trabalho quando a colmeia esta parada. Eventos de canais diferentes podem
+// chegar fora de ordem (varios expansores): a insercao procura a posicao a
+// partir do final. Cada canal precisa receber os seus em ordem de tempo.
+//
+// Os tempos sao contadores de 32 bits livres (ex.: time_us_32()). Todas as
+// comparacoes usam a diferenca com sinal, entao o overflow do contador nao
+// afeta o resultado enquanto a janela for menor que metade do periodo.
+class BeeGateMatcher{
+    private:
+        typedef struct{
+            uint32_t time;        // Instante do evento (us)
+            uint8_t channel;      // Canal dono do evento
+            uint8_t next_channel; // Proximo evento do mesmo canal
+            uint8_t prev, next;   // Lista global ordenada por tempo
+        } pending_t;
+
+        typedef struct{
+            uint8_t head, tail;   // FIFO de eventos pendentes do canal
+            uint8_t side;         // Lado dos eventos pendentes (bee_gate_side_t)
+        } channel_t;
+
+        uint32_t _window;         // Janela maxima para casar ENTRY/EXIT (us)
+        pending_t _pool[BEE_GATE_POOL_SIZE];
+        channel_t _channels[BEE_GATE_MAX_CHANNELS];
+        uint8_t _free;            // Lista de nos livres
+        uint8_t _oldest, _newest; // Lista global de pendentes
+        uint32_t _dropped;        // Eventos descartados por falta de espaco no pool
+        uint32_t _expired;        // Eventos que nunca encontraram o par
+
+        void push(uint8_t channel, uint32_t time);
+        void popHead(uint8_t channel);
+        bool outsideWindow(uint32_t time, uint32_t now);
+
+    public:
+        // Construtor
+        BeeGateMatcher(uint32_t window);
+
+        // Metodos
+        void reset(); // Descarta todos os eventos pendentes
+        bee_passage_t onEdge(uint8_t channel, bee_gate_side_t side, uint32_t time, uint32_t *transit = NULL); // Novo evento de sensor, transit recebe a duracao da passagem
+        uint32_t expire(uint32_t now); // Descarta eventos pendentes fora da janela, retorna quantos
+        bool nextDeadline(uint32_t *deadline); // Proximo instante em que expire() tera trabalho
+        // Getters
+        uint32_t getDropped();
+        uint32_t getExpired();
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef COREAFFINITY_H
+#define COREAFFINITY_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Divisao dos nucleos no modo SMP (FREERTOS_SMP):
+//   nucleo 0 - radio: IRQ de background do cyw43 (lwIP, TLS), MqttCore, MqttReport e o tick
+//   nucleo 1 - sensores: IRQ dos MCP23017 e do I2C, servico dos expansores,
+//              casamento das passagens, balancas e VOC
+// As IRQs ficam no nucleo que as habilita: o cyw43_arch_init roda no main
+// (nucleo 0) e as IRQs dos sensores sao habilitadas pelas proprias tasks.
+// Com um nucleo so as mascaras nao tem efeito.
+#define CORE_RADIO 0
+#define CORE_SENSORS 1
+
+#if (configNUMBER_OF_CORES > 1) && (configUSE_CORE_AFFINITY == 1)
+#define CORE_AFFINITY_RADIO   ((UBaseType_t)1 << CORE_RADIO)
+#define CORE_AFFINITY_SENSORS ((UBaseType_t)1 << CORE_SENSORS)
+#else
+#define CORE_AFFINITY_RADIO   tskNO_AFFINITY
+#define CORE_AFFINITY_SENSORS tskNO_AFFINITY
+#endif
+
+// xTaskCreateStatic com mascara de nucleos (ignorada sem SMP)
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static inline TaskHandle_t xTaskCreateStaticPinned(TaskFunction_t code, const char *name, configSTACK_DEPTH_TYPE stack,
+                                                   void *params, UBaseType_t priority, StackType_t *stackBuffer,
+                                                   StaticTask_t *tcb, UBaseType_t affinity){
+#if (configNUMBER_OF_CORES > 1) && (configUSE_CORE_AFFINITY == 1)
+    return xTaskCreateStaticAffinitySet(code, name, stack, params, priority, stackBuffer, tcb, affinity);
+#else
+    (void)affinity;
+    return xTaskCreateStatic(code, name, stack, params, priority, stackBuffer, tcb);
+#endif
+}
+#endif
+
+// xTaskCreate com mascara de nucleos (ignorada sem SMP)
+static inline BaseType_t xTaskCreatePinned(TaskFunction_t code, const char *name, configSTACK_DEPTH_TYPE stack,
+                                           void *params, UBaseType_t priority, TaskHandle_t *handle,
+                                           UBaseType_t affinity){
+#if (configNUMBER_OF_CORES > 1) && (configUSE_CORE_AFFINITY == 1)
+    return xTaskCreateAffinitySet(code, name, stack, params, priority, affinity, handle);
+#else
+    (void)affinity;
+    return xTaskCreate(code, name, stack, params, priority, handle);
+#endif
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include "CoreLoad.h"
+
+CoreLoad::CoreLoad(){
+    for(int i = 0; i < configNUMBER_OF_CORES; i++){
+        _idle[i] = NULL;
+        _idle_time[i] = 0;
+    }
+    _time = 0;
+    _started = false;
+}
+
+void CoreLoad::begin(){
+    for(BaseType_t i = 0; i < configNUMBER_OF_CORES; i++){
+#if configNUMBER_OF_CORES > 1
+        _idle[i] = xTaskGetIdleTaskHandleForCore(i);
+#if configUSE_CORE_AFFINITY == 1
+        vTaskCoreAffinitySet(_idle[i], (UBaseType_t)1 << i);
+#endif
+#else
+        _idle[i] = xTaskGetIdleTaskHandle();
+#endif
+    }
+    _started = false;
+}
+
+bool CoreLoad::sample(uint8_t busy[configNUMBER_OF_CORES]){
+    // Mesmo relogio do portGET_RUN_TIME_COUNTER_VALUE
+    uint32_t now = portGET_RUN_TIME_COUNTER_VALUE();
+    uint32_t elapsed = now - _time;
+    bool valid = _started && elapsed > 0;
+
+    for(int i = 0; i < configNUMBER_OF_CORES; i++){
+        uint32_t idle = ulTaskGetRunTimeCounter(_idle[i]);
+        if(valid){
+            // Diferencas sem sinal: o contador de 32 bits pode dar a volta (71 min)
+            uint32_t idle_delta = idle - _idle_time[i];
+            if(idle_delta > elapsed) idle_delta = elapsed;
+            busy[i] = (uint8_t)(100u - (uint32_t)(((uint64_t)idle_delta * 100u) / elapsed));
+        }
+        _idle_time[i] = idle;
+    }
+    _time = now;
+    _started = true;
+    return valid;
+}
@@ -0,0 +1,27 @@
+#ifndef CORELOAD_H
+#define CORELOAD_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Ocupacao de cada nucleo a partir do tempo das tasks idle (run time stats,
+// contador de 1 us). No SMP as idle podem migrar entre os nucleos, entao o
+// begin prende a idle i no nucleo i: o tempo dela passa a ser o ocio do nucleo.
+class CoreLoad{
+    private:
+        TaskHandle_t _idle[configNUMBER_OF_CORES];
+        uint32_t _idle_time[configNUMBER_OF_CORES]; // Contador da idle na ultima amostra
+        uint32_t _time;                             // Instante da ultima amostra (us)
+        bool _started;
+
+    public:
+        // Construtor
+        CoreLoad();
+
+        // Metodos
+        void begin(); // Com o scheduler rodando
+        // Ocupacao (%) de cada nucleo desde a amostra anterior; false na primeira chamada
+        bool sample(uint8_t busy[configNUMBER_OF_CORES]);
+};
+
+#endif
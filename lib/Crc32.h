@@ -0,0 +1,18 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+// CRC-32 (IEEE), bit a bit: usado nos registros gravados na flash, que sao
+// lidos so no boot e verificados a cada gravacao
+static inline uint32_t crc32(const uint8_t *data, uint32_t len){
+    uint32_t crc = 0xFFFFFFFF;
+    for(uint32_t i = 0; i < len; i++){
+        crc ^= data[i];
+        for(int b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include "Diagnostics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+static_assert(configNUMBER_OF_CORES <= TELEMETRY_HEALTH_MAX_CORES, "TELEMETRY_HEALTH_MAX_CORES nao cobre os nucleos");
+static_assert(DIAGNOSTICS_MAX_TASKS <= 255, "DIAGNOSTICS_MAX_TASKS precisa caber em uint8_t");
+
+Diagnostics::Diagnostics(MqttClient *client, const char *topic)
+    : _client(client), _topic(topic){
+    _previous_count = 0;
+    _time = 0;
+    _sleep_us = 0;
+    _sequence = 0;
+}
+
+void Diagnostics::begin(){
+    uint8_t busy[configNUMBER_OF_CORES];
+    _coreLoad.begin();
+    _coreLoad.sample(busy);
+
+    uint32_t total;
+    UBaseType_t count = uxTaskGetSystemState(_status, DIAGNOSTICS_MAX_TASKS, &total);
+    for(UBaseType_t i = 0; i < count; i++){
+        _previous[i].number = _status[i].xTaskNumber;
+        _previous[i].run_time = _status[i].ulRunTimeCounter;
+    }
+    _previous_count = count;
+    _time = portGET_RUN_TIME_COUNTER_VALUE();
+
+    low_power_stats_t sleep;
+    low_power_get_stats(&sleep);
+    _sleep_us = sleep.sleep_us;
+}
+
+uint32_t Diagnostics::previousRunTime(UBaseType_t number){
+    for(UBaseType_t i = 0; i < _previous_count; i++){
+        if(_previous[i].number == number) return _previous[i].run_time;
+    }
+    return 0; // Task criada depois da amostra anterior
+}
+
+bool Diagnostics::publish(){
+    // Com mais tasks que DIAGNOSTICS_MAX_TASKS o uxTaskGetSystemState nao
+    // preenche nada: a quantidade total ainda vai no cabecalho
+    uint32_t total;
+    UBaseType_t tasks = uxTaskGetNumberOfTasks();
+    UBaseType_t count = uxTaskGetSystemState(_status, DIAGNOSTICS_MAX_TASKS, &total);
+    uint32_t now = portGET_RUN_TIME_COUNTER_VALUE();
+    uint32_t elapsed = now - _time;
+
+    telemetry_health_t health = {};
+    health.uptime_s = (uint32_t)(to_us_since_boot(get_absolute_time()) / 1000000); // 64 bits: o contador em ms volta a zero em 49,7 dias
+    health.heap_free = xPortGetFreeHeapSize();
+    health.heap_min_free = xPortGetMinimumEverFreeHeapSize();
+    low_power_stats_t sleep;
+    low_power_get_stats(&sleep);
+    uint64_t slept = sleep.sleep_us - _sleep_us;
+    health.sleep_pm = elapsed ? (uint16_t)(slept >= elapsed ? 1000 : (slept * 1000u) / elapsed) : 0;
+    health.cores = configNUMBER_OF_CORES;
+    if(!_coreLoad.sample(health.core_busy)) memset(health.core_busy, 0, sizeof(health.core_busy));
+    health.task_count = tasks > 255 ? 255 : tasks;
+
+    // CPU de cada task na janela, em milesimos de um nucleo
+    uint16_t cpu[DIAGNOSTICS_MAX_TASKS];
+    uint8_t order[DIAGNOSTICS_MAX_TASKS];
+    for(UBaseType_t i = 0; i < count; i++){
+        uint32_t delta = _status[i].ulRunTimeCounter - previousRunTime(_status[i].xTaskNumber);
+        uint64_t pm = elapsed ? ((uint64_t)delta * 1000u) / elapsed : 0;
+        cpu[i] = pm > 1000 ? 1000 : (uint16_t)pm;
+
+        // Insercao ordenada, da maior CPU para a menor (poucas tasks)
+        UBaseType_t j = i;
+        while(j > 0 && cpu[order[j - 1]] < cpu[i]){
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    telemetry_batch_t msg;
+    telemetry_health_init(&msg, _buffer, sizeof(_buffer), _sequence, &health);
+    for(UBaseType_t k = 0; k < count; k++){
+        TaskStatus_t *status = &_status[order[k]];
+        telemetry_task_health_t task;
+        strncpy(task.name, status->pcTaskName, TELEMETRY_HEALTH_NAME_LEN);
+        task.name[TELEMETRY_HEALTH_NAME_LEN] = '\0';
+        task.cpu_pm = cpu[order[k]];
+        task.stack_free = status->usStackHighWaterMark;
+        if(!telemetry_health_append(&msg, &task)) break; // Payload cheio: as de menor CPU ficam de fora
+    }
+
+    // Nova janela
+    for(UBaseType_t i = 0; i < count; i++){
+        _previous[i].number = _status[i].xTaskNumber;
+        _previous[i].run_time = _status[i].ulRunTimeCounter;
+    }
+    _previous_count = count;
+    _time = now;
+    _sleep_us = sleep.sleep_us;
+
+    printf("[DIAG] Heap livre %lu (min %lu), sono %u/1000, %u tasks, %u no relatorio\n", (unsigned long)health.heap_free,
+           (unsigned long)health.heap_min_free, health.sleep_pm, (unsigned)tasks, msg.count);
+    _sequence++;
+    return _client->publish(_topic, _buffer, msg.length);
+}
@@ -0,0 +1,48 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MqttClient.h"
+#include "CoreLoad.h"
+#include "LowPower.h"
+#include "telemetry.h"
+
+#define DIAGNOSTICS_MAX_TASKS 16           // Tasks acompanhadas (as demais ficam fora da amostra)
+#define DIAGNOSTICS_INTERVAL_MS (5 * 60 * 1000) // Periodo da mensagem de saude
+
+// Saude do firmware em campo: CPU de cada task desde o ultimo relatorio
+// (run time stats, 1 us), menor folga de pilha de cada task, heap livre e o
+// menor valor desde o boot (heap_4), a ocupacao dos nucleos e o tempo em sono
+// (tickless idle). Tudo sai numa
+// mensagem TELEMETRY_HEALTH compacta, com as tasks da maior CPU para a menor.
+class Diagnostics{
+    private:
+        typedef struct{
+            UBaseType_t number; // xTaskNumber: unico por task, mesmo com nomes repetidos
+            uint32_t run_time;  // Contador da task na amostra anterior
+        } previous_t;
+
+        MqttClient *_client;
+        const char *_topic;
+        CoreLoad _coreLoad;
+        TaskStatus_t _status[DIAGNOSTICS_MAX_TASKS];
+        previous_t _previous[DIAGNOSTICS_MAX_TASKS];
+        UBaseType_t _previous_count;
+        uint32_t _time;     // Contador de run time na amostra anterior
+        uint64_t _sleep_us; // Tempo em sono na amostra anterior
+        uint32_t _sequence;
+        uint8_t _buffer[MQTT_MAX_PAYLOAD];
+
+        uint32_t previousRunTime(UBaseType_t number);
+
+    public:
+        // Construtor
+        Diagnostics(MqttClient *client, const char *topic);
+
+        // Metodos
+        void begin();   // Com o scheduler rodando: zera a janela de CPU
+        bool publish(); // Amostra e publica a mensagem de saude
+};
+
+#endif
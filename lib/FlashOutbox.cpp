@@ -0,0 +1,291 @@
+#include "FlashOutbox.h"
+#include "Crc32.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "pico/flash.h"
+
+#define FLASH_OUTBOX_TIMEOUT_MS 100 // Espera maxima para parar o outro nucleo
+#define FLASH_OUTBOX_HEADER_CRC_START offsetof(flash_outbox_record_t, magic)
+
+static_assert(sizeof(flash_outbox_record_t) + FLASH_OUTBOX_MAX_TOPIC + 128 <= FLASH_PAGE_SIZE,
+              "Mensagem da fila duravel nao cabe em uma pagina");
+
+typedef struct{
+    uint32_t offset;       // Primeira pagina
+    uint32_t count;        // Paginas seguidas
+    bool erase;            // Apaga o setor da primeira pagina antes de gravar
+    const uint8_t *data;
+    const uint32_t *pages; // Se != NULL: paginas avulsas, todas com a mesma data
+} flash_outbox_op_t;
+
+// Executa com as interrupcoes desligadas e sem acesso ao XIP (flash_safe_execute)
+static void flash_outbox_op(void *param){
+    flash_outbox_op_t *op = (flash_outbox_op_t *)param;
+    if(op->pages != NULL){
+        for(uint32_t i = 0; i < op->count; i++)
+            flash_range_program(FLASH_OUTBOX_OFFSET + op->pages[i] * FLASH_PAGE_SIZE, op->data, FLASH_PAGE_SIZE);
+        return;
+    }
+    if(op->erase)
+        flash_range_erase(op->offset & ~(FLASH_SECTOR_SIZE - 1), FLASH_SECTOR_SIZE);
+    flash_range_program(op->offset, op->data, op->count * FLASH_PAGE_SIZE);
+}
+
+// Fim do programa na flash (linker do SDK)
+extern "C" char __flash_binary_end;
+
+static uint8_t batch_buffer[FLASH_OUTBOX_BATCH][FLASH_PAGE_SIZE];
+static uint8_t ack_page[FLASH_PAGE_SIZE];
+
+FlashOutbox::FlashOutbox(){
+    _head = 0;
+    _tail = 0;
+    _sequence = 0;
+    _pending = 0;
+    _lost = 0;
+    _enabled = false;
+    _staged = 0;
+    _eraseStaged = false;
+    _ackCount = 0;
+}
+
+const flash_outbox_record_t *FlashOutbox::record(uint32_t page){
+    return (const flash_outbox_record_t *)(XIP_BASE + FLASH_OUTBOX_OFFSET + page * FLASH_PAGE_SIZE);
+}
+
+bool FlashOutbox::isValid(const flash_outbox_record_t *rec){
+    if(rec->magic != FLASH_OUTBOX_MAGIC) return false;
+    uint32_t size = sizeof(flash_outbox_record_t) + rec->topic_len + rec->length;
+    if(rec->topic_len == 0 || rec->topic_len > FLASH_OUTBOX_MAX_TOPIC || size > FLASH_PAGE_SIZE) return false;
+    const uint8_t *bytes = (const uint8_t *)rec;
+    return rec->crc == crc32(bytes + FLASH_OUTBOX_HEADER_CRC_START, size - FLASH_OUTBOX_HEADER_CRC_START);
+}
+
+bool FlashOutbox::isPending(const flash_outbox_record_t *rec){
+    return rec->ack == 0xFFFFFFFF && isValid(rec);
+}
+
+bool FlashOutbox::isErased(uint32_t page){
+    const uint32_t *words = (const uint32_t *)record(page);
+    for(uint32_t i = 0; i < FLASH_PAGE_SIZE / sizeof(uint32_t); i++)
+        if(words[i] != 0xFFFFFFFF) return false;
+    return true;
+}
+
+bool FlashOutbox::program(uint32_t page, uint32_t count, bool erase_sector){
+    flash_outbox_op_t op;
+    op.offset = FLASH_OUTBOX_OFFSET + page * FLASH_PAGE_SIZE;
+    op.count = count;
+    op.erase = erase_sector;
+    op.data = batch_buffer[0];
+    op.pages = NULL;
+    int status = flash_safe_execute(flash_outbox_op, &op, FLASH_OUTBOX_TIMEOUT_MS);
+    if(status != PICO_OK){
+        printf("[OUTBOX] Falha ao gravar na flash (%d)\n", status);
+        return false;
+    }
+    return true;
+}
+
+bool FlashOutbox::programAcks(const uint32_t *pages, uint32_t count){
+    // Gravar 0xFF nao altera a flash: so a palavra ack muda
+    memset(ack_page, 0xFF, sizeof(ack_page));
+    ((flash_outbox_record_t *)ack_page)->ack = 0;
+
+    flash_outbox_op_t op;
+    op.offset = 0;
+    op.count = count;
+    op.erase = false;
+    op.data = ack_page;
+    op.pages = pages;
+    int status = flash_safe_execute(flash_outbox_op, &op, FLASH_OUTBOX_TIMEOUT_MS);
+    if(status != PICO_OK){
+        printf("[OUTBOX] Falha ao gravar as confirmacoes (%d)\n", status);
+        return false;
+    }
+    return true;
+}
+
+uint32_t FlashOutbox::next(uint32_t page){
+    return (page + 1 < FLASH_OUTBOX_PAGES) ? page + 1 : 0;
+}
+
+void FlashOutbox::trim(){
+    // Avanca o inicio do log sobre as mensagens ja confirmadas
+    while(_tail != _head && !isPending(record(_tail)))
+        _tail = next(_tail);
+}
+
+bool FlashOutbox::begin(){
+    // O log fica logo abaixo do estado do VOC, no fim da flash: um programa que
+    // cresceu ate ele seria apagado pela primeira mensagem gravada
+    _enabled = (uintptr_t)&__flash_binary_end <= XIP_BASE + FLASH_OUTBOX_OFFSET;
+    if(!_enabled){
+        printf("[OUTBOX] O programa invade a regiao do log na flash (%lu > %lu), fila duravel desativada\n",
+               (unsigned long)((uintptr_t)&__flash_binary_end - XIP_BASE), (unsigned long)FLASH_OUTBOX_OFFSET);
+        return false;
+    }
+
+    // A mensagem valida mais nova marca o fim do log; a pendente mais antiga, o inicio
+    uint32_t newest = FLASH_OUTBOX_NONE, oldest = FLASH_OUTBOX_NONE;
+    _pending = 0;
+    _staged = 0;
+    _ackCount = 0;
+    for(uint32_t page = 0; page < FLASH_OUTBOX_PAGES; page++){
+        const flash_outbox_record_t *rec = record(page);
+        if(!isValid(rec)) continue;
+        if(newest == FLASH_OUTBOX_NONE || (int32_t)(rec->sequence - record(newest)->sequence) > 0)
+            newest = page;
+        if(rec->ack != 0xFFFFFFFF) continue;
+        _pending++;
+        if(oldest == FLASH_OUTBOX_NONE || (int32_t)(rec->sequence - record(oldest)->sequence) < 0)
+            oldest = page;
+    }
+
+    if(newest == FLASH_OUTBOX_NONE){
+        _head = 0;
+        _sequence = 0;
+    } else {
+        _head = next(newest);
+        _sequence = record(newest)->sequence + 1;
+    }
+    _tail = (oldest == FLASH_OUTBOX_NONE) ? _head : oldest;
+    if(_pending)
+        printf("[OUTBOX] %lu mensagens pendentes na flash\n", (unsigned long)_pending);
+    return true;
+}
+
+bool FlashOutbox::append(const char *topic, const uint8_t *payload, uint16_t length){
+    uint32_t topic_len = strlen(topic) + 1;
+    uint32_t size = sizeof(flash_outbox_record_t) + topic_len + length;
+    if(!_enabled || topic_len > FLASH_OUTBOX_MAX_TOPIC || size > FLASH_PAGE_SIZE) return false;
+
+    // Um lote e uma sequencia de paginas dentro de um setor
+    if(_staged == FLASH_OUTBOX_BATCH || (_staged > 0 && (_head + _staged) % FLASH_OUTBOX_PAGES_PER_SECTOR == 0)){
+        if(!flushMessages()) return false;
+    }
+
+    if(_staged == 0){
+        // Pagina com lixo (gravacao interrompida no meio do setor): pula para o proximo setor
+        if(_head % FLASH_OUTBOX_PAGES_PER_SECTOR != 0 && !isErased(_head)){
+            while(_head % FLASH_OUTBOX_PAGES_PER_SECTOR != 0)
+                _head = next(_head);
+        }
+
+        // Entrando em um setor: o flush apaga o que ainda estiver nele
+        _eraseStaged = false;
+        if(_head % FLASH_OUTBOX_PAGES_PER_SECTOR == 0){
+            for(uint32_t page = _head; page < _head + FLASH_OUTBOX_PAGES_PER_SECTOR; page++)
+                if(!isErased(page)) _eraseStaged = true;
+        }
+    }
+
+    uint8_t *page = batch_buffer[_staged];
+    flash_outbox_record_t *rec = (flash_outbox_record_t *)page;
+    memset(page, 0xFF, FLASH_PAGE_SIZE);
+    rec->magic = FLASH_OUTBOX_MAGIC;
+    rec->sequence = _sequence + _staged;
+    rec->length = length;
+    rec->topic_len = topic_len;
+    rec->reserved = 0;
+    memcpy(page + sizeof(flash_outbox_record_t), topic, topic_len);
+    memcpy(page + sizeof(flash_outbox_record_t) + topic_len, payload, length);
+    rec->crc = crc32(page + FLASH_OUTBOX_HEADER_CRC_START, size - FLASH_OUTBOX_HEADER_CRC_START);
+    _staged++;
+    return true;
+}
+
+bool FlashOutbox::flushMessages(){
+    if(_staged == 0) return true;
+    // Confirmacoes antes: uma delas pode ser de uma pagina do setor a apagar
+    flushAcks();
+
+    // Mensagens ainda pendentes no setor a apagar (log cheio)
+    uint32_t lost = 0;
+    if(_eraseStaged){
+        for(uint32_t page = _head; page < _head + FLASH_OUTBOX_PAGES_PER_SECTOR; page++)
+            if(isPending(record(page))) lost++;
+    }
+
+    uint32_t count = _staged;
+    _staged = 0;
+    if(!program(_head, count, _eraseStaged)){
+        _lost += count;
+        return false;
+    }
+    if(lost){
+        printf("[OUTBOX] Log cheio: %lu mensagens antigas descartadas\n", (unsigned long)lost);
+        _lost += lost;
+        _pending -= lost;
+    }
+
+    uint32_t sector = _head / FLASH_OUTBOX_PAGES_PER_SECTOR;
+    if(_pending == 0){
+        _tail = _head;
+    } else if(_eraseStaged && _tail / FLASH_OUTBOX_PAGES_PER_SECTOR == sector){
+        // O inicio do log estava no setor apagado: passa para o setor seguinte
+        _tail = ((sector + 1) % FLASH_OUTBOX_SECTORS) * FLASH_OUTBOX_PAGES_PER_SECTOR;
+    }
+    _head = (_head + count) % FLASH_OUTBOX_PAGES;
+    _sequence += count;
+    _pending += count;
+    trim();
+    return true;
+}
+
+bool FlashOutbox::flushAcks(){
+    if(_ackCount == 0) return true;
+    uint32_t count = _ackCount;
+    _ackCount = 0;
+    // Se falhar, as mensagens continuam pendentes e sao reenviadas (QoS 1)
+    if(!programAcks(_acks, count)) return false;
+    _pending -= count;
+    trim();
+    return true;
+}
+
+bool FlashOutbox::flush(){
+    bool acks = flushAcks();
+    return flushMessages() && acks;
+}
+
+bool FlashOutbox::read(uint32_t page, const char **topic, const uint8_t **payload, uint16_t *length, uint32_t *sequence){
+    const flash_outbox_record_t *rec = record(page);
+    if(!isPending(rec)) return false;
+    const uint8_t *data = (const uint8_t *)(rec + 1);
+    *topic = (const char *)data;
+    *payload = data + rec->topic_len;
+    *length = rec->length;
+    *sequence = rec->sequence;
+    return true;
+}
+
+bool FlashOutbox::ack(uint32_t page, uint32_t sequence){
+    // A pagina pode ter sido apagada (log cheio) enquanto a mensagem estava em voo
+    const flash_outbox_record_t *rec = record(page);
+    if(!isPending(rec) || rec->sequence != sequence) return false;
+    for(uint32_t i = 0; i < _ackCount; i++)
+        if(_acks[i] == page) return false;
+
+    if(_ackCount == FLASH_OUTBOX_BATCH && !flushAcks()) return false;
+    _acks[_ackCount++] = page;
+    return true;
+}
+
+uint32_t FlashOutbox::oldest(){
+    return _tail;
+}
+
+uint32_t FlashOutbox::end(){
+    return _head;
+}
+
+uint32_t FlashOutbox::pending(){
+    return _pending;
+}
+
+uint32_t FlashOutbox::lost(){
+    return _lost;
+}
@@ -0,0 +1,81 @@
+#ifndef FLASHOUTBOX_H
+#define FLASHOUTBOX_H
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "VocStateStore.h"
+
+// Regiao do log: os setores logo antes do estado do VOC
+#define FLASH_OUTBOX_SECTORS 64 // 256 KB, 1024 mensagens
+#define FLASH_OUTBOX_OFFSET (VOC_STATE_FLASH_OFFSET - FLASH_OUTBOX_SECTORS * FLASH_SECTOR_SIZE)
+#define FLASH_OUTBOX_PAGES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define FLASH_OUTBOX_PAGES (FLASH_OUTBOX_SECTORS * FLASH_OUTBOX_PAGES_PER_SECTOR)
+#define FLASH_OUTBOX_MAGIC 0x4D514F31 // "MQO1"
+#define FLASH_OUTBOX_MAX_TOPIC 64     // Com o '\0'
+#define FLASH_OUTBOX_NONE 0xFFFFFFFF
+#define FLASH_OUTBOX_BATCH 4          // Paginas gravadas por flash_safe_execute
+
+typedef struct{
+    uint32_t ack;       // 0xFFFFFFFF pendente, 0 confirmado (gravado por cima, sem apagar)
+    uint32_t crc;       // CRC-32 de magic ate o fim do payload
+    uint32_t magic;
+    uint32_t sequence;  // Cresce a cada mensagem: ordem de envio
+    uint16_t length;    // Bytes do payload
+    uint8_t topic_len;  // Bytes do topico, com o '\0'
+    uint8_t reserved;
+    // Em seguida: topico e payload
+} flash_outbox_record_t;
+
+// Fila de saida duravel do MQTT: log circular na flash, uma mensagem por
+// pagina. A escrita avanca pagina a pagina e apaga cada setor so ao entrar
+// nele, entao o desgaste e distribuido por todos os setores da regiao. A
+// confirmacao (PUBACK) zera a palavra ack da pagina sem apagar nada. Se o log
+// enche, o setor mais antigo e apagado mesmo com mensagens pendentes.
+//
+// Cada flash_safe_execute desliga as interrupcoes e para o outro nucleo: cerca
+// de 0,5 ms por pagina e ~45 ms quando apaga um setor. Por isso mensagens e
+// confirmacoes sao acumuladas em lotes de ate FLASH_OUTBOX_BATCH paginas e
+// gravadas de uma vez no flush (ou quando o lote enche).
+class FlashOutbox{
+    private:
+        uint32_t _head;     // Proxima pagina a gravar (depois do lote)
+        uint32_t _tail;     // Pagina pendente mais antiga (_head se vazio)
+        uint32_t _sequence; // Sequencia da proxima mensagem
+        uint32_t _pending;  // Mensagens gravadas e nao confirmadas
+        uint32_t _lost;     // Mensagens perdidas (log cheio ou falha na gravacao)
+        bool _enabled;      // Regiao conferida no begin
+        uint32_t _staged;   // Mensagens no lote, a partir de _head
+        bool _eraseStaged;  // O lote comeca um setor que precisa ser apagado
+        uint32_t _acks[FLASH_OUTBOX_BATCH]; // Paginas confirmadas ainda nao gravadas
+        uint32_t _ackCount;
+
+        static const flash_outbox_record_t *record(uint32_t page);
+        static bool isValid(const flash_outbox_record_t *rec);
+        static bool isPending(const flash_outbox_record_t *rec);
+        static bool isErased(uint32_t page);
+        static bool program(uint32_t page, uint32_t count, bool erase_sector);
+        static bool programAcks(const uint32_t *pages, uint32_t count);
+        bool flushMessages();
+        bool flushAcks();
+        void trim();
+
+    public:
+        // Construtor
+        FlashOutbox();
+
+        // Metodos
+        bool begin(); // Confere a regiao e reconstroi o estado a partir da flash
+        bool append(const char *topic, const uint8_t *payload, uint16_t length); // Vai para o lote
+        bool flush(); // Grava o lote de mensagens e de confirmacoes
+        // Mensagem pendente da pagina; false se a pagina nao tem mensagem pendente
+        bool read(uint32_t page, const char **topic, const uint8_t **payload, uint16_t *length, uint32_t *sequence);
+        bool ack(uint32_t page, uint32_t sequence); // Confirma e libera a mensagem (no flush)
+
+        static uint32_t next(uint32_t page);
+        uint32_t oldest(); // Primeira pagina a reenviar
+        uint32_t end();    // Fim do log (pagina ainda nao gravada)
+        uint32_t pending();
+        uint32_t lost();
+};
+
+#endif
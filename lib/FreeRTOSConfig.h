@@ -42,7 +42,14 @@
  
  /* Scheduler Related */
  #define configUSE_PREEMPTION                    1
+ /* FREERTOS_TICKLESS (CMake): sem tasks prontas o nucleo dorme sem tick ate o
+  * proximo prazo (vPortSuppressTicksAndSleep do LowPower.cpp, no lugar do port) */
+ #ifdef FREERTOS_TICKLESS
+ #define configUSE_TICKLESS_IDLE                 2
+ #define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   2
+ #else
  #define configUSE_TICKLESS_IDLE                 0
+ #endif
  #define configUSE_IDLE_HOOK                     0
  #define configUSE_TICK_HOOK                     0
  #define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
@@ -63,24 +70,39 @@
  #define configUSE_NEWLIB_REENTRANT              0
  #define configENABLE_BACKWARD_COMPATIBILITY     0
  #define configNUM_THREAD_LOCAL_STORAGE_POINTERS 5
+ #define configTASK_NOTIFICATION_ARRAY_ENTRIES   2 /* Indice 1: fim de transacao do I2CEngine */
  
  /* System */
  #define configSTACK_DEPTH_TYPE                  uint32_t
  #define configMESSAGE_BUFFER_LENGTH_TYPE        size_t
  
  /* Memory allocation related definitions. */
+ /* FREERTOS_STATIC (CMake): tasks, filas e mutexes da aplicacao em memoria
+  * estatica (KernelMemory.h). O heap_4 fica so para o que o SDK cria sozinho
+  * (task de bloqueio do flash_safe_execute no SMP) */
+ #ifdef FREERTOS_STATIC
+ #define configSUPPORT_STATIC_ALLOCATION         1
+ #define configTOTAL_HEAP_SIZE                   (8*1024)
+ #else
  #define configSUPPORT_STATIC_ALLOCATION         0
- #define configSUPPORT_DYNAMIC_ALLOCATION        1
  #define configTOTAL_HEAP_SIZE                   (128*1024)
+ #endif
+ #define configSUPPORT_DYNAMIC_ALLOCATION        1
  #define configAPPLICATION_ALLOCATED_HEAP        0
  
  /* Hook function related definitions. */
  #define configCHECK_FOR_STACK_OVERFLOW          0
- #define configUSE_MALLOC_FAILED_HOOK            0
+ #define configUSE_MALLOC_FAILED_HOOK            1 /* KernelMemory.cpp */
  #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
  
  /* Run time and task stats gathering related definitions. */
- #define configGENERATE_RUN_TIME_STATS           0
+ /* Tempo de CPU por task em us (timer de 1 MHz do RP2040): CoreLoad e Diagnostics */
+ #define configGENERATE_RUN_TIME_STATS           1
+ #ifndef __ASSEMBLER__
+ #include "hardware/timer.h"
+ #endif
+ #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()  /* O timer do RP2040 ja roda desde o boot */
+ #define portGET_RUN_TIME_COUNTER_VALUE()        time_us_32()
  #define configUSE_TRACE_FACILITY                1
  #define configUSE_STATS_FORMATTING_FUNCTIONS    0
  
@@ -102,8 +124,19 @@
  */
  
  /* SMP port only */
- #define configNUM_CORES                         1
- #define configTICK_CORE                         1
+ /* FREERTOS_SMP (CMake): os dois nucleos, com as tasks presas pelas mascaras
+  * do CoreAffinity.h (radio no nucleo 0, sensores no nucleo 1) */
+ #ifdef FREERTOS_SMP
+ #ifdef FREERTOS_TICKLESS
+ #error "FREERTOS_TICKLESS so com um nucleo: o tick suprimido no nucleo 0 nao acompanha as tasks do nucleo 1"
+ #endif
+ #define configNUMBER_OF_CORES                   2
+ #define configUSE_CORE_AFFINITY                 1
+ #define configUSE_PASSIVE_IDLE_HOOK             0
+ #else
+ #define configNUMBER_OF_CORES                   1
+ #endif
+ #define configTICK_CORE                         0
  #define configRUN_MULTIPLE_PRIORITIES           1
  
  /* RP2040 specific */
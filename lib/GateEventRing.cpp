@@ -0,0 +1,44 @@
+#include "GateEventRing.h"
+
+static_assert((GATE_EVENT_RING_DEPTH & (GATE_EVENT_RING_DEPTH - 1)) == 0, "GATE_EVENT_RING_DEPTH precisa ser potencia de 2");
+
+#define GATE_EVENT_RING_MASK (GATE_EVENT_RING_DEPTH - 1)
+
+GateEventRing::GateEventRing() : _head(0), _tail(0), _overflows(0){
+}
+
+bool GateEventRing::push(const gate_event_t &event){
+    uint32_t head = _head;
+    uint32_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+
+    // Indices crescem livremente, a diferenca da a ocupacao mesmo com overflow do uint32
+    if((head - tail) >= GATE_EVENT_RING_DEPTH){
+        __atomic_store_n(&_overflows, _overflows + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    _buffer[head & GATE_EVENT_RING_MASK] = event;
+    // Publica o evento so depois de escrito no buffer
+    __atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool GateEventRing::pop(gate_event_t *event){
+    uint32_t tail = _tail;
+    uint32_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+
+    if(head == tail) return false;
+
+    *event = _buffer[tail & GATE_EVENT_RING_MASK];
+    // Libera a posicao so depois de copiar o evento
+    __atomic_store_n(&_tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint32_t GateEventRing::count(){
+    return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+}
+
+uint32_t GateEventRing::getOverflows(){
+    return __atomic_load_n(&_overflows, __ATOMIC_RELAXED);
+}
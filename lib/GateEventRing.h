@@ -0,0 +1,45 @@
+#ifndef GATEEVENTRING_H
+#define GATEEVENTRING_H
+
+#include <stdint.h>
+
+// Profundidade do ring de eventos (precisa ser potencia de 2)
+#ifndef GATE_EVENT_RING_DEPTH
+#define GATE_EVENT_RING_DEPTH 128
+#endif
+
+#define GATE_EDGE_FALL 0 // Sensor ativado (feixe interrompido)
+#define GATE_EDGE_RISE 1 // Sensor liberado
+
+typedef struct{
+    // Evento de um sensor de passagem, 8 bytes
+    uint32_t time;    // Instante do evento (us, time_us_32 registrado na ISR)
+    uint8_t expander; // Indice do expansor
+    uint8_t port;     // 0 = PORTA (entrada), 1 = PORTB (dentro)
+    uint8_t pin;      // Pino dentro do port (0-7)
+    uint8_t edge;     // GATE_EDGE_FALL ou GATE_EDGE_RISE
+} gate_event_t;
+
+// Ring buffer lock-free de um produtor e um consumidor (SPSC).
+// O produtor so escreve _head e o consumidor so escreve _tail, entao nao ha
+// secao critica: a publicacao do evento e feita com store release/load acquire.
+class GateEventRing{
+    private:
+        gate_event_t _buffer[GATE_EVENT_RING_DEPTH];
+        uint32_t _head;      // Proxima posicao de escrita (produtor)
+        uint32_t _tail;      // Proxima posicao de leitura (consumidor)
+        uint32_t _overflows; // Eventos perdidos com o ring cheio (produtor)
+
+    public:
+        // Construtor
+        GateEventRing();
+
+        // Metodos
+        bool push(const gate_event_t &event); // Somente o produtor
+        bool pop(gate_event_t *event);        // Somente o consumidor
+        // Getters
+        uint32_t count();
+        uint32_t getOverflows();
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include "hardware/pio.h"
 #include "hardware/clocks.h"
+#include "hardware/dma.h"
 #include "FreeRTOS.h"
 #include "FreeRTOSConfig.h"
 #include "task.h"
@@ -9,17 +10,27 @@
 #include "hx711.pio.h"
 
 
+static_assert((HX711_STREAM_DEPTH & (HX711_STREAM_DEPTH - 1)) == 0, "HX711_STREAM_DEPTH precisa ser potencia de 2");
+
+#define HX711_STREAM_TRANSFERS 0xFFFFFFFFu // ~620 dias a 80 SPS por disparo do DMA
+#define HX711_STALE_TIMEOUT_US (HX711_STALE_TIMEOUT_MS * 1000ull)
+
+// Extensão de sinal: 24 bits -> 32 bits (complemento de 2)
+static inline int32_t sign_extend24(uint32_t raw){
+    if (raw & 0x800000) {
+        raw |= 0xFF000000;
+    }
+    return (int32_t)raw;
+}
+
+
 HX711::HX711(uint pin_data, uint pin_clock)
     : _pin_data(pin_data), _pin_clock(pin_clock){
     _scale = 1.0f;
     _offset_value = 0;
 };
 
-void HX711::begin(PIO pio, uint sm, uint offset){
-    _pio = pio;
-    _sm = sm;
-    _offset = offset;
-
+void HX711::initPins(){
     // Inicializa os pinos
     gpio_init(_pin_data);
     gpio_set_dir(_pin_data, GPIO_IN);
@@ -55,6 +66,13 @@ void HX711::begin(PIO pio, uint sm, uint offset){
     } else {
         printf("HX711 está pronto! (DOUT=LOW)\n");
     }
+}
+
+void HX711::begin(PIO pio, uint sm, uint offset){
+    _pio = pio;
+    _sm = sm;
+    _offset = offset;
+    initPins();
 
     // Configura o PIO
     pio_sm_config c = hx711_program_get_default_config(_offset);
@@ -77,11 +95,160 @@ void HX711::begin(PIO pio, uint sm, uint offset){
 }
 
 
+bool HX711::beginStream(PIO pio, uint sm, uint offset, uint8_t gain_pulses){
+    _pio = pio;
+    _sm = sm;
+    _offset = offset;
+    initPins();
+
+    if(gain_pulses == 0) gain_pulses = 1; // Padrão: ganho 128
+    if(gain_pulses > 3) gain_pulses = 3; // 1 a 3 pulsos: ganhos 128, 32 e 64
+
+    // Mesmo clock do modo por requisicao, mas com autopush a cada 24 bits e
+    // FIFO de RX com 8 posicoes: o PIO nunca espera a CPU
+    pio_sm_config c = hx711_stream_program_get_default_config(_offset);
+    sm_config_set_in_pins(&c, _pin_data);
+    sm_config_set_set_pins(&c, _pin_clock, 1);
+
+    float div = clock_get_hz(clk_sys) / 500000.0f;
+    sm_config_set_clkdiv(&c, div);
+    sm_config_set_in_shift(&c, false, true, 24);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+
+    pio_gpio_init(_pio, _pin_data);
+    pio_gpio_init(_pio, _pin_clock);
+    pio_sm_set_consecutive_pindirs(_pio, _sm, _pin_clock, 1, true);
+    pio_sm_init(_pio, _sm, _offset, &c);
+
+    // Carrega os pulsos de ganho no OSR antes de liberar a SM. Com o FIFO de
+    // TX juntado ao de RX nao da para usar put/pull: o valor vai como
+    // imediato (1 a 3 pulsos cabem nos 5 bits do set)
+    pio_sm_exec(_pio, _sm, pio_encode_set(pio_x, gain_pulses - 1));
+    pio_sm_exec(_pio, _sm, pio_encode_mov(pio_osr, pio_x));
+
+    // DMA: FIFO de RX -> ring, no ritmo do DREQ da SM. O endereco de escrita
+    // da a volta sozinho (ring de HX711_STREAM_DEPTH palavras alinhadas)
+    _dma = dma_claim_unused_channel(false);
+    if(_dma < 0){
+        printf("HX711: sem canal de DMA livre\n");
+        return false;
+    }
+    dma_channel_config d = dma_channel_get_default_config(_dma);
+    channel_config_set_transfer_data_size(&d, DMA_SIZE_32);
+    channel_config_set_read_increment(&d, false);
+    channel_config_set_write_increment(&d, true);
+    channel_config_set_ring(&d, true, __builtin_ctz(sizeof(_ring)));
+    channel_config_set_dreq(&d, pio_get_dreq(_pio, _sm, false));
+    dma_channel_configure(_dma, &d, _ring, &_pio->rxf[_sm], HX711_STREAM_TRANSFERS, true);
+
+    _sample_base = 0;
+    _last_count = 0;
+    _last_sample_us = time_us_64();
+    _sps_count = 0;
+    _sps_time = _last_sample_us;
+    _sps = 0.0f;
+    _streaming = true;
+
+    pio_sm_set_enabled(_pio, _sm, true);
+    printf("HX711 em modo continuo (DATA=GPIO%d, CLK=GPIO%d, DMA %d)\n", _pin_data, _pin_clock, _dma);
+    return true;
+}
+
+
+uint32_t HX711::update(){
+    uint32_t count = _sample_base + (HX711_STREAM_TRANSFERS - dma_channel_hw_addr(_dma)->transfer_count);
+
+    // Disparo do DMA esgotado: rearma continuando do mesmo ponto do ring
+    if(!dma_channel_is_busy(_dma)){
+        _sample_base += HX711_STREAM_TRANSFERS;
+        dma_channel_set_trans_count(_dma, HX711_STREAM_TRANSFERS, true);
+    }
+
+    uint64_t now = time_us_64();
+    if(count != _last_count){
+        _last_count = count;
+        _last_sample_us = now;
+    }
+    // Taxa medida em janelas de pelo menos 1 s
+    if(now - _sps_time >= 1000000){
+        _sps = (float)(count - _sps_count) * 1000000.0f / (float)(now - _sps_time);
+        _sps_count = count;
+        _sps_time = now;
+    }
+    return count;
+}
+
+
+int32_t HX711::sample(uint32_t index){
+    return sign_extend24(_ring[index & (HX711_STREAM_DEPTH - 1)] & 0xFFFFFF);
+}
+
+
+bool HX711::is_stale(){
+    if(!_streaming) return false;
+    update();
+    return time_us_64() - _last_sample_us > HX711_STALE_TIMEOUT_US;
+}
+
+
+uint32_t HX711::get_sample_count(){
+    return _streaming ? update() : 0;
+}
+
+
+float HX711::get_samples_per_second(){
+    if(_streaming) update();
+    return _sps;
+}
+
+
+bool HX711::stream_average(int readings, float *average){
+    uint32_t count = update();
+    if(count == 0 || is_stale()) return false;
+
+    // A posicao mais antiga do ring pode estar sendo sobrescrita pelo DMA
+    uint32_t n = (uint32_t)readings;
+    if(n > HX711_STREAM_DEPTH - 1) n = HX711_STREAM_DEPTH - 1;
+    if(n > count) n = count;
+    if(n == 0) n = 1;
+
+    int64_t sum = 0;
+    for(uint32_t i = 1; i <= n; i++)
+        sum += sample(count - i);
+    *average = (float)(sum / (int32_t)n);
+    return true;
+}
+
+
+float HX711::average_raw(int readings){
+    if(_streaming){
+        // Espera amostras novas o suficiente, ou o HX711 parar de responder
+        float average = _offset_value;
+        uint32_t start = update();
+        uint32_t wanted = (uint32_t)readings < HX711_STREAM_DEPTH ? (uint32_t)readings : HX711_STREAM_DEPTH - 1;
+        while(update() - start < wanted && !is_stale())
+            vTaskDelay(pdMS_TO_TICKS(10));
+        stream_average(readings, &average);
+        return average;
+    }
+
+    int64_t sum = 0;
+    for(int i = 0; i<readings; i++){
+        sum += read_raw();
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return (float)(sum/readings);
+}
+
+
 int32_t HX711::read_raw(uint8_t gain_pulses){
     // Ganho 128 (canal A) = 1 pulso  -> enviar 0
     // Ganho 32  (canal B) = 2 pulsos -> enviar 1
     // Ganho 64  (canal A) = 3 pulsos -> enviar 2
     
+    // Modo continuo: o ganho foi fixado no beginStream
+    if(_streaming) return sample(update() - 1);
+
     if(gain_pulses == 0) gain_pulses = 1; // Padrão: ganho 128
     
     // Envia (pulsos - 1) porque o PIO faz jmp x--
@@ -90,23 +257,12 @@ int32_t HX711::read_raw(uint8_t gain_pulses){
     // Recebe os 24 bits
     uint32_t raw = pio_sm_get_blocking(_pio, _sm);
 
-    // Extensão de sinal: 24 bits -> 32 bits (complemento de 2)
-    if (raw & 0x800000) {
-        raw |= 0xFF000000;
-    }
-    
-    return (int32_t)raw;
+    return sign_extend24(raw);
 }
 
 
 void HX711::tare(int readings){
-    int64_t sum = 0;
-    for(int i = 0; i<readings; i++){
-        sum += read_raw();
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
-        
-    _offset_value = sum/readings;
+    _offset_value = (int32_t)average_raw(readings);
 }
 
 
@@ -116,6 +272,15 @@ void HX711::set_scale(float scale){
 
 
 float HX711::get_units(int readings){
+    if(_streaming){
+        // Media das amostras mais novas do ring, sem bloquear. Com o HX711
+        // parado o ultimo peso valido e mantido (ver is_stale)
+        float average;
+        if(stream_average(readings, &average))
+            _last_weight = (average - _offset_value) / _scale;
+        return _last_weight;
+    }
+
     int64_t sum = 0;
     for (int i = 0; i < readings; i++) {
         sum += read_raw();
@@ -139,11 +304,7 @@ float HX711::calibrate_auto(float known_weight, int readings){
     // O peso (known_weight) tem que ser em gramas (g)
     tare(readings);
 
-    int64_t sum = 0;
-    for(int i=0; i<readings; i++)
-        sum+=read_raw();
-    
-    float raw_units = (sum/readings) - _offset_value;
+    float raw_units = average_raw(readings) - _offset_value;
     _scale = raw_units/known_weight;
     return _scale;    
 }
@@ -5,6 +5,12 @@
 #include "hardware/pio.h"
 #include "hx711.pio.h"
 
+// Modo continuo: amostras guardadas no ring preenchido pelo DMA (potencia de 2)
+#define HX711_STREAM_DEPTH 32
+// Sem amostra nova por esse tempo a leitura e considerada velha (HX711
+// desconectado). A 10 SPS chega uma amostra a cada 100 ms.
+#define HX711_STALE_TIMEOUT_MS 500
+
 class HX711{
     private:
         PIO _pio;
@@ -16,16 +22,37 @@ class HX711{
         int32_t _offset_value = 0;
         float _last_weight = 0.0f;
 
+        // Modo continuo (PIO + DMA)
+        bool _streaming = false;
+        int _dma = -1;
+        uint32_t _ring[HX711_STREAM_DEPTH] __attribute__((aligned(HX711_STREAM_DEPTH * sizeof(uint32_t))));
+        uint32_t _sample_base;    // Amostras de disparos anteriores do DMA
+        uint32_t _last_count;     // Total de amostras na ultima verificacao
+        uint64_t _last_sample_us; // Quando o total mudou pela ultima vez
+        uint32_t _sps_count;      // Total no inicio da janela de taxa
+        uint64_t _sps_time;
+        float _sps = 0.0f;
+
+        void initPins();
+        uint32_t update(); // Atualiza total, validade e taxa; retorna o total de amostras
+        int32_t sample(uint32_t index); // Amostra de numero index, com sinal
+        bool stream_average(int readings, float *average); // Media das amostras mais novas, sem bloquear
+        float average_raw(int readings); // Media de leituras novas (usada na tara e calibracao)
+
     public:
         // Construtor
         HX711(uint pin_data, uint pin_clock);
         // Metodos
         void begin(PIO pio, uint sm, uint offset);
-        int32_t read_raw(uint8_t gain_pulses=1);
+        bool beginStream(PIO pio, uint sm, uint offset, uint8_t gain_pulses=1); // offset do hx711_stream_program
+        int32_t read_raw(uint8_t gain_pulses=1); // No modo continuo retorna a amostra mais nova, sem bloquear
         void tare(int readings = 10);
         void set_scale(float scale);
         float get_units(int readings = 1);
         float get_last_weight();
+        bool is_stale();             // Modo continuo: sem amostra nova ha HX711_STALE_TIMEOUT_MS
+        uint32_t get_sample_count(); // Modo continuo: amostras recebidas desde o beginStream
+        float get_samples_per_second();
         float calibrate_auto(float known_weight, int readings = 20);
         float calbirate_manual(float known_weight, int readings = 20);
 };
@@ -0,0 +1,198 @@
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "FreeRTOS.h"
+#include "FreeRTOSConfig.h"
+#include "task.h"
+#include "HX711Array.h"
+#include "hx711.pio.h"
+
+
+HX711Array::HX711Array(uint pin_data_base, uint count, uint pin_clock)
+    : _pin_data_base(pin_data_base), _pin_clock(pin_clock){
+    _count = (count > HX711_ARRAY_MAX_CELLS) ? HX711_ARRAY_MAX_CELLS : count;
+    _sm = -1;
+    for(uint i = 0; i < HX711_ARRAY_MAX_CELLS; i++){
+        _scale[i] = 1.0f;
+        _offset_value[i] = 0;
+        _last_weight[i] = 0.0f;
+    }
+}
+
+
+bool HX711Array::begin(PIO pio, uint8_t gain_pulses){
+    _pio = pio;
+    if(_count == 0) return false;
+    if(gain_pulses == 0) gain_pulses = 1; // Padrão: ganho 128
+
+    // Cada palavra do FIFO guarda um numero inteiro de grupos de N bits e cada
+    // leitura um numero inteiro de palavras: maior divisor de 24 com k * N <= 32
+    static const uint8_t divisors[] = {24, 12, 8, 6, 4, 3, 2, 1};
+    for(uint i = 0; i < sizeof(divisors); i++){
+        if(divisors[i] * _count <= 32){
+            _bits_per_word = divisors[i];
+            break;
+        }
+    }
+    _words = 24 / _bits_per_word;
+
+    // Ajusta a largura das leituras e o ganho antes de carregar o programa
+    memcpy(_instructions, hx711_array_program.instructions, hx711_array_program.length * sizeof(uint16_t));
+    _instructions[hx711_array_offset_patch_ready] = pio_encode_out(pio_x, _count);
+    _instructions[hx711_array_offset_patch_in] = pio_encode_in(pio_pins, _count);
+    _instructions[hx711_array_offset_patch_gain] = pio_encode_set(pio_x, gain_pulses - 1);
+    _program = hx711_array_program;
+    _program.instructions = _instructions;
+
+    if(!pio_can_add_program(_pio, &_program)){
+        printf("HX711Array: sem espaco no PIO\n");
+        return false;
+    }
+    _sm = pio_claim_unused_sm(_pio, false);
+    if(_sm < 0){
+        printf("HX711Array: sem state machine livre\n");
+        return false;
+    }
+    _offset = pio_add_program(_pio, &_program);
+
+    // Inicializa os pinos: com o SCK em LOW os HX711 ligam e comecam a converter
+    for(uint i = 0; i < _count; i++){
+        gpio_init(_pin_data_base + i);
+        gpio_set_dir(_pin_data_base + i, GPIO_IN);
+        gpio_pull_up(_pin_data_base + i);
+    }
+    gpio_init(_pin_clock);
+    gpio_set_dir(_pin_clock, GPIO_OUT);
+    gpio_put(_pin_clock, 0);
+    vTaskDelay(pdMS_TO_TICKS(100)); // Aguarda estabilização
+
+    // Configura o PIO
+    pio_sm_config c = hx711_array_program_get_default_config(_offset);
+    sm_config_set_in_pins(&c, _pin_data_base);
+    sm_config_set_set_pins(&c, _pin_clock, 1);
+
+    float div = clock_get_hz(clk_sys) / 500000.0f;
+    sm_config_set_clkdiv(&c, div);
+    sm_config_set_out_shift(&c, true, false, 32); // DOUTs saem pelos bits baixos do OSR
+    sm_config_set_in_shift(&c, false, true, _bits_per_word * _count);
+    // FIFOs separados: o TX leva os pedidos de leitura. O RX (4 palavras) e
+    // esvaziado durante a leitura; com ele cheio a SM para no in, com o SCK em
+    // LOW, sem desligar os HX711
+
+    for(uint i = 0; i < _count; i++)
+        pio_gpio_init(_pio, _pin_data_base + i);
+    pio_gpio_init(_pio, _pin_clock);
+    pio_sm_set_consecutive_pindirs(_pio, _sm, _pin_data_base, _count, false);
+    pio_sm_set_consecutive_pindirs(_pio, _sm, _pin_clock, 1, true);
+
+    pio_sm_init(_pio, _sm, _offset, &c);
+    pio_sm_set_enabled(_pio, _sm, true);
+
+    printf("HX711Array inicializado no PIO (%u celulas, DATA=GPIO%u-%u, CLK=GPIO%u)\n",
+           _count, _pin_data_base, _pin_data_base + _count - 1, _pin_clock);
+    return true;
+}
+
+
+void HX711Array::restart(){
+    // Leitura sem resposta: descarta o pedido pendente e volta ao inicio do programa
+    pio_sm_set_enabled(_pio, _sm, false);
+    pio_sm_clear_fifos(_pio, _sm);
+    pio_sm_restart(_pio, _sm);
+    pio_sm_exec(_pio, _sm, pio_encode_jmp(_offset));
+    pio_sm_set_enabled(_pio, _sm, true);
+}
+
+
+bool HX711Array::read_raw(int32_t *values, uint32_t timeout_ms){
+    if(_sm < 0) return false;
+
+    pio_sm_put(_pio, _sm, 0); // Pede uma leitura
+
+    // Separa os bits: cada grupo de N bits e uma borda do SCK (bit j = celula j),
+    // o grupo mais antigo fica na parte alta da palavra e o MSB vem primeiro.
+    // Cada palavra e tirada do FIFO assim que chega, sem prender a CPU
+    uint32_t raw[HX711_ARRAY_MAX_CELLS] = {0};
+    uint32_t mask = (1u << _count) - 1;
+    uint32_t start = time_us_32();
+    for(uint8_t w = 0; w < _words; w++){
+        while(pio_sm_is_rx_fifo_empty(_pio, _sm)){
+            if(time_us_32() - start > timeout_ms * 1000){
+                restart();
+                return false;
+            }
+            vTaskDelay(pdMS_TO_TICKS(1));
+        }
+        uint32_t word = pio_sm_get(_pio, _sm);
+        for(int g = _bits_per_word - 1; g >= 0; g--){
+            uint32_t group = (word >> (g * _count)) & mask;
+            for(uint j = 0; j < _count; j++)
+                raw[j] = (raw[j] << 1) | ((group >> j) & 1);
+        }
+    }
+
+    for(uint j = 0; j < _count; j++){
+        // Extensão de sinal: 24 bits -> 32 bits (complemento de 2)
+        if (raw[j] & 0x800000) {
+            raw[j] |= 0xFF000000;
+        }
+        values[j] = (int32_t)raw[j];
+    }
+    return true;
+}
+
+
+bool HX711Array::average_raw(int readings, float *average){
+    int64_t sum[HX711_ARRAY_MAX_CELLS] = {0};
+    int32_t values[HX711_ARRAY_MAX_CELLS];
+    int valid = 0;
+
+    for(int i = 0; i < readings; i++){
+        if(!read_raw(values)) continue;
+        for(uint j = 0; j < _count; j++)
+            sum[j] += values[j];
+        valid++;
+    }
+    if(valid == 0) return false;
+
+    for(uint j = 0; j < _count; j++)
+        average[j] = (float)(sum[j] / valid);
+    return true;
+}
+
+
+bool HX711Array::tare(int readings){
+    float average[HX711_ARRAY_MAX_CELLS];
+    if(!average_raw(readings, average)) return false;
+    for(uint j = 0; j < _count; j++)
+        _offset_value[j] = (int32_t)average[j];
+    return true;
+}
+
+
+void HX711Array::set_scale(uint cell, float scale){
+    if(cell < _count) _scale[cell] = scale;
+}
+
+
+bool HX711Array::get_units(int readings){
+    float average[HX711_ARRAY_MAX_CELLS];
+    if(!average_raw(readings, average)) return false;
+
+    // Formula: (ValorLido - Tara) / Escala
+    for(uint j = 0; j < _count; j++)
+        _last_weight[j] = (average[j] - _offset_value[j]) / _scale[j];
+    return true;
+}
+
+
+float HX711Array::get_last_weight(uint cell){
+    return (cell < _count) ? _last_weight[cell] : 0.0f;
+}
+
+
+uint HX711Array::get_count(){
+    return _count;
+}
@@ -0,0 +1,47 @@
+#ifndef HX711ARRAY_H
+#define HX711ARRAY_H
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hx711.pio.h"
+
+#define HX711_ARRAY_MAX_CELLS 8        // DOUTs consecutivos lidos pela mesma SM
+#define HX711_ARRAY_TIMEOUT_MS 500     // Sem conversao nesse tempo: celula desconectada
+
+// Varias balancas (uma fileira de colmeias) em uma unica state machine.
+// Todos os HX711 recebem o mesmo SCK e os DOUTs ficam em pinos consecutivos a
+// partir de pin_data_base. Cada borda le um bit de todas as celulas, entao as
+// leituras sao simultaneas; os bits chegam intercalados e sao separados aqui.
+class HX711Array{
+    private:
+        PIO _pio;
+        int _sm;
+        uint _offset;
+        uint _pin_data_base;
+        uint _pin_clock;
+        uint _count;
+        uint8_t _bits_per_word;  // Bits de cada celula por palavra do FIFO
+        uint8_t _words;          // Palavras do FIFO por leitura
+        uint16_t _instructions[32];
+        pio_program_t _program;  // hx711_array_program ajustado para _count celulas
+        float _scale[HX711_ARRAY_MAX_CELLS];
+        int32_t _offset_value[HX711_ARRAY_MAX_CELLS];
+        float _last_weight[HX711_ARRAY_MAX_CELLS];
+
+        void restart();
+        bool average_raw(int readings, float *average);
+
+    public:
+        // Construtor
+        HX711Array(uint pin_data_base, uint count, uint pin_clock);
+        // Metodos
+        bool begin(PIO pio, uint8_t gain_pulses = 1); // Carrega o programa e reserva uma SM
+        bool read_raw(int32_t *values, uint32_t timeout_ms = HX711_ARRAY_TIMEOUT_MS); // Uma leitura de todas as celulas
+        bool tare(int readings = 10);
+        void set_scale(uint cell, float scale);
+        bool get_units(int readings = 1); // Atualiza o peso de todas as celulas
+        float get_last_weight(uint cell);
+        uint get_count();
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "I2CDmaTransport.h"
+
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+// Um transporte por controlador I2C, para a IRQ encontrar a instancia
+static I2CDmaTransport *transports[2] = {NULL, NULL};
+
+I2CDmaTransport::I2CDmaTransport(i2c_inst_t *i2c, uint pin_sda, uint pin_scl, uint baudrate)
+    : _i2c(i2c), _pin_sda(pin_sda), _pin_scl(pin_scl), _baudrate(baudrate){
+    _dma_tx = -1;
+    _dma_rx = -1;
+    _notify = NULL;
+    _aborted = false;
+}
+
+bool I2CDmaTransport::begin(){
+    // Iniciando o I2C
+    i2c_init(_i2c, _baudrate);
+    gpio_set_function(_pin_sda, GPIO_FUNC_I2C);
+    gpio_set_function(_pin_scl, GPIO_FUNC_I2C);
+    gpio_pull_up(_pin_sda);
+    gpio_pull_up(_pin_scl);
+
+    // DMA de comandos: memoria -> IC_DATA_CMD, ritmo pelo DREQ de TX
+    i2c_hw_t *hw = i2c_get_hw(_i2c);
+    _dma_tx = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(_dma_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(_i2c, true));
+    dma_channel_configure(_dma_tx, &c, &hw->data_cmd, _commands, 0, false);
+
+    // DMA de leitura: IC_DATA_CMD -> memoria, ritmo pelo DREQ de RX
+    _dma_rx = dma_claim_unused_channel(true);
+    c = dma_channel_get_default_config(_dma_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, i2c_get_dreq(_i2c, false));
+    dma_channel_configure(_dma_rx, &c, NULL, &hw->data_cmd, 0, false);
+
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    hw->dma_tdlr = 4; // Repoe o FIFO de TX (16 posicoes) antes de esvaziar
+    hw->dma_rdlr = 0; // Copia cada byte recebido
+    hw->intr_mask = 0; // So habilitado durante uma transacao por DMA
+
+    transports[i2c_hw_index(_i2c)] = this;
+    irq_set_exclusive_handler(i2c_hw_index(_i2c) ? I2C1_IRQ : I2C0_IRQ, irqHandler);
+    return true;
+}
+
+void I2CDmaTransport::enableIrq(){
+    irq_set_enabled(i2c_hw_index(_i2c) ? I2C1_IRQ : I2C0_IRQ, true);
+}
+
+void I2CDmaTransport::irqHandler(){
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    for(int i = 0; i < 2; i++){
+        I2CDmaTransport *self = transports[i];
+        if(self == NULL) continue;
+        i2c_hw_t *hw = i2c_get_hw(self->_i2c);
+        uint32_t status = hw->intr_stat;
+        if(status == 0) continue;
+
+        if(status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS){
+            // Para o DMA antes de liberar o FIFO, senao os comandos restantes
+            // sairiam como uma nova transacao
+            dma_channel_abort(self->_dma_tx);
+            dma_channel_abort(self->_dma_rx);
+            self->_aborted = true;
+            (void)hw->clr_tx_abrt;
+        }
+        if(status & I2C_IC_INTR_STAT_R_STOP_DET_BITS){
+            (void)hw->clr_stop_det;
+        }
+        hw->intr_mask = 0;
+        vTaskNotifyGiveIndexedFromISR(self->_notify, I2C_ENGINE_NOTIFY_INDEX, &xHigherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+void I2CDmaTransport::recover(){
+    i2c_hw_t *hw = i2c_get_hw(_i2c);
+    hw->intr_mask = 0;
+    dma_channel_abort(_dma_tx);
+    dma_channel_abort(_dma_rx);
+
+    // Timeout sem TX_ABRT: pede o abort ao controlador e espera ele liberar o barramento
+    if(!_aborted){
+        hw->enable |= I2C_IC_ENABLE_ABORT_BITS;
+        for(int i = 0; i < 1000 && (hw->enable & I2C_IC_ENABLE_ABORT_BITS); i++)
+            busy_wait_us_32(10);
+        (void)hw->clr_tx_abrt;
+    }
+    // Descarta o que sobrou no FIFO de RX
+    while(hw->rxflr)
+        (void)hw->data_cmd;
+    (void)hw->clr_intr;
+}
+
+void I2CDmaTransport::start(const i2c_transaction_t *t, TaskHandle_t notify){
+    i2c_hw_t *hw = i2c_get_hw(_i2c);
+    uint16_t total = t->tx_len + t->rx_len;
+
+    // Monta os comandos: escritas, leituras (RESTART na primeira) e STOP no ultimo
+    for(uint16_t i = 0; i < t->tx_len; i++)
+        _commands[i] = t->tx[i];
+    for(uint16_t i = 0; i < t->rx_len; i++)
+        _commands[t->tx_len + i] = I2C_IC_DATA_CMD_CMD_BITS;
+    if(t->tx_len && t->rx_len)
+        _commands[t->tx_len] |= I2C_IC_DATA_CMD_RESTART_BITS;
+    _commands[total - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    // O endereco so pode ser trocado com o controlador desabilitado
+    hw->enable = 0;
+    hw->tar = t->address;
+    hw->enable = 1;
+
+    _notify = notify;
+    _aborted = false;
+    (void)hw->clr_intr;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+    if(t->rx_len)
+        dma_channel_transfer_to_buffer_now(_dma_rx, t->rx, t->rx_len);
+    dma_channel_transfer_from_buffer_now(_dma_tx, _commands, total);
+}
+
+int I2CDmaTransport::finish(const i2c_transaction_t *t, bool completed){
+    if(!completed || _aborted){
+        recover();
+        return I2C_ENGINE_ERROR;
+    }
+
+    // O STOP ja saiu, o DMA so precisa copiar os ultimos bytes do FIFO
+    while(dma_channel_is_busy(_dma_rx))
+        tight_loop_contents();
+    return t->tx_len + t->rx_len;
+}
+
+int I2CDmaTransport::transferBlocking(const i2c_transaction_t *t){
+    // Usado antes do escalonador iniciar: mesmo resultado, sem DMA
+    int status;
+    if(t->tx_len){
+        status = i2c_write_blocking(_i2c, t->address, t->tx, t->tx_len, t->rx_len > 0);
+        if(status != t->tx_len) return I2C_ENGINE_ERROR;
+    }
+    if(t->rx_len){
+        status = i2c_read_blocking(_i2c, t->address, t->rx, t->rx_len, false);
+        if(status != t->rx_len) return I2C_ENGINE_ERROR;
+    }
+    return t->tx_len + t->rx_len;
+}
@@ -0,0 +1,36 @@
+#ifndef I2CDMATRANSPORT_H
+#define I2CDMATRANSPORT_H
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "I2CEngine.h"
+
+// Transporte do I2CEngine no RP2040: cada transacao vira uma lista de palavras
+// do IC_DATA_CMD enviada por DMA, com um segundo canal de DMA esvaziando o RX.
+// O fim chega pela IRQ do I2C (STOP_DET / TX_ABRT).
+class I2CDmaTransport : public I2CTransport{
+    private:
+        i2c_inst_t *_i2c;
+        uint _pin_sda, _pin_scl;
+        uint _baudrate;
+        int _dma_tx, _dma_rx;
+        TaskHandle_t _notify;                   // Task avisada pela IRQ
+        volatile bool _aborted;
+        uint32_t _commands[I2C_ENGINE_MAX_LEN]; // Palavras escritas no IC_DATA_CMD pelo DMA
+
+        void recover();
+        static void irqHandler();
+
+    public:
+        // Construtor
+        I2CDmaTransport(i2c_inst_t *i2c, uint pin_sda, uint pin_scl, uint baudrate);
+
+        // Metodos (I2CTransport)
+        bool begin() override;
+        void enableIrq() override;
+        void start(const i2c_transaction_t *t, TaskHandle_t notify) override;
+        int finish(const i2c_transaction_t *t, bool completed) override;
+        int transferBlocking(const i2c_transaction_t *t) override;
+};
+
+#endif
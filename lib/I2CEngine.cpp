@@ -0,0 +1,119 @@
+#include "I2CEngine.h"
+
+#include <stdio.h>
+
+#define I2C_ENGINE_TIMEOUT_MS 20  // A 400 kHz, 32 bytes levam menos de 1 ms
+
+static I2CEngine *default_engine = NULL;
+
+I2CEngine::I2CEngine(I2CTransport *transport) : _transport(transport){
+    _queues[I2C_PRIORITY_HIGH] = NULL;
+    _queues[I2C_PRIORITY_NORMAL] = NULL;
+    _task = NULL;
+    _errors = 0;
+}
+
+bool I2CEngine::begin(UBaseType_t priority, UBaseType_t affinity){
+    if(!_transport->begin()){
+        printf("[I2C] Erro ao iniciar o barramento\n");
+        return false;
+    }
+
+    static const char *queue_names[I2C_NUM_PRIORITIES] = {"I2C high", "I2C normal"};
+    for(int i = 0; i < I2C_NUM_PRIORITIES; i++){
+        _queues[i] = _queueMemory[i].create(queue_names[i]);
+        if(_queues[i] == NULL){
+            printf("[I2C] Erro ao criar fila de prioridade %d\n", i);
+            return false;
+        }
+    }
+
+    if(_taskMemory.create(taskImpl, "I2CEngine", this, priority, &_task, affinity) != pdPASS){
+        printf("[I2C] Erro ao criar a task do motor\n");
+        return false;
+    }
+
+    if(default_engine == NULL) default_engine = this;
+    return true;
+}
+
+I2CEngine *I2CEngine::getDefault(){
+    return default_engine;
+}
+
+uint32_t I2CEngine::getErrors(){
+    return _errors;
+}
+
+int I2CEngine::execute(i2c_transaction_t *t){
+    uint16_t total = t->tx_len + t->rx_len;
+    if(total == 0 || total > I2C_ENGINE_MAX_LEN) return I2C_ENGINE_ERROR;
+
+    ulTaskNotifyTakeIndexed(I2C_ENGINE_NOTIFY_INDEX, pdTRUE, 0); // Descarta aviso antigo
+    _transport->start(t, _task);
+
+    // A CPU fica livre ate o aviso do transporte (STOP ou abort)
+    bool done = ulTaskNotifyTakeIndexed(I2C_ENGINE_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(I2C_ENGINE_TIMEOUT_MS)) != 0;
+    int result = _transport->finish(t, done);
+    if(result == I2C_ENGINE_ERROR) _errors++;
+    return result;
+}
+
+bool I2CEngine::submit(i2c_transaction_t *t, uint8_t priority){
+    if(priority >= I2C_NUM_PRIORITIES) priority = I2C_PRIORITY_NORMAL;
+    if(xQueueSend(_queues[priority], &t, 0) != pdTRUE) return false;
+    xTaskNotifyGive(_task);
+    return true;
+}
+
+int I2CEngine::transfer(uint8_t address, const uint8_t *tx, uint16_t tx_len, uint8_t *rx, uint16_t rx_len, uint8_t priority){
+    i2c_transaction_t t;
+    t.address = address;
+    t.tx = tx;
+    t.tx_len = tx_len;
+    t.rx = rx;
+    t.rx_len = rx_len;
+    t.result = I2C_ENGINE_ERROR;
+    t.notify = NULL;
+    t.callback = NULL;
+    t.arg = NULL;
+
+    // Usado antes do escalonador iniciar: mesmo resultado, sem a task
+    if(_task == NULL || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+        return _transport->transferBlocking(&t);
+
+    t.notify = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTakeIndexed(I2C_ENGINE_NOTIFY_INDEX, pdTRUE, 0);
+    // Espera uma vaga na fila; o motor sempre conclui a transacao (tem timeout proprio)
+    while(!submit(&t, priority))
+        vTaskDelay(1);
+    ulTaskNotifyTakeIndexed(I2C_ENGINE_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+    return t.result;
+}
+
+// Task dona do barramento
+void I2CEngine::taskImpl(void *_this){
+    I2CEngine *self = (I2CEngine *)_this;
+    i2c_transaction_t *t;
+
+    self->_transport->enableIrq();
+
+    while(true){
+        // Sempre olha a fila de maior prioridade primeiro
+        if(xQueueReceive(self->_queues[I2C_PRIORITY_HIGH], &t, 0) != pdTRUE &&
+           xQueueReceive(self->_queues[I2C_PRIORITY_NORMAL], &t, 0) != pdTRUE){
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Aguarda novas transacoes
+            continue;
+        }
+
+        t->result = self->execute(t);
+        // Callback antes da notificacao: depois dela a transacao pode deixar de existir
+        if(t->callback != NULL) t->callback(t->arg, t->result);
+        if(t->notify != NULL) xTaskNotifyGiveIndexed(t->notify, I2C_ENGINE_NOTIFY_INDEX);
+    }
+}
+
+int i2c_engine_transfer(uint8_t address, const uint8_t *tx, uint16_t tx_len, uint8_t *rx, uint16_t rx_len, uint8_t priority){
+    if(default_engine == NULL) return I2C_ENGINE_ERROR;
+    return default_engine->transfer(address, tx, tx_len, rx, rx_len, priority);
+}
@@ -0,0 +1,98 @@
+#ifndef I2CENGINE_H
+#define I2CENGINE_H
+
+#include <stdint.h>
+
+// Prioridades das transacoes: a fila HIGH e sempre esvaziada antes da NORMAL
+#define I2C_PRIORITY_HIGH 0   // Atendimento dos sensores de passagem (MCP23017)
+#define I2C_PRIORITY_NORMAL 1 // Medicoes lentas (SGP40, configuracao)
+#define I2C_NUM_PRIORITIES 2
+
+// Maior transacao suportada (bytes escritos + lidos)
+#define I2C_ENGINE_MAX_LEN 32
+#define I2C_ENGINE_QUEUE_LENGTH 8 // Transacoes aguardando por prioridade
+#define I2C_ENGINE_STACK (configMINIMAL_STACK_SIZE + 128)
+// Indice de notificacao usado para avisar o fim de uma transacao sincrona,
+// livre para a task usar o indice 0 para outras coisas
+#define I2C_ENGINE_NOTIFY_INDEX 1
+
+#define I2C_ENGINE_ERROR -1 // NACK, arbitragem perdida ou timeout
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// API em C para as bibliotecas em C (HAL da Sensirion). Usa o motor padrao.
+// Escreve tx_len bytes e, se rx_len > 0, le rx_len bytes com repeated start.
+// Retorna o numero de bytes transferidos ou I2C_ENGINE_ERROR.
+int i2c_engine_transfer(uint8_t address, const uint8_t *tx, uint16_t tx_len, uint8_t *rx, uint16_t rx_len, uint8_t priority);
+
+#ifdef __cplusplus
+}
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+#include "KernelMemory.h"
+
+typedef void (*i2c_done_cb_t)(void *arg, int result);
+
+typedef struct{
+    uint8_t address;        // Endereco de 7 bits
+    const uint8_t *tx;      // Bytes a escrever (pode ser NULL se tx_len = 0)
+    uint16_t tx_len;
+    uint8_t *rx;            // Destino da leitura (pode ser NULL se rx_len = 0)
+    uint16_t rx_len;
+    int result;             // Bytes transferidos ou I2C_ENGINE_ERROR
+    TaskHandle_t notify;    // Task notificada (I2C_ENGINE_NOTIFY_INDEX) no fim, ou NULL
+    i2c_done_cb_t callback; // Chamada no contexto do motor no fim, ou NULL
+    void *arg;
+} i2c_transaction_t;
+
+// Acesso ao barramento usado pelo motor: o I2CDmaTransport no RP2040 e um mock
+// nos testes do host. Uma transacao por vez, sempre a partir da task do motor.
+class I2CTransport{
+    public:
+        virtual bool begin() = 0;     // Barramento e recursos, antes do scheduler
+        virtual void enableIrq() = 0; // Chamado pela task do motor: a IRQ fica no nucleo dela
+        // Inicia a transacao (tx_len + rx_len entre 1 e I2C_ENGINE_MAX_LEN). O
+        // fim, com sucesso ou erro, notifica a task em I2C_ENGINE_NOTIFY_INDEX
+        virtual void start(const i2c_transaction_t *t, TaskHandle_t notify) = 0;
+        // Depois do aviso (completed) ou do timeout: bytes transferidos ou
+        // I2C_ENGINE_ERROR, deixando o barramento pronto para a proxima
+        virtual int finish(const i2c_transaction_t *t, bool completed) = 0;
+        virtual int transferBlocking(const i2c_transaction_t *t) = 0; // Sem scheduler
+};
+
+// Motor de transacoes I2C: uma task dona do barramento executa as transacoes
+// enfileiradas por prioridade pelo transporte (DMA no RP2040), sem prender a
+// CPU. O fim de cada transacao chega por notificacao (IRQ do I2C no RP2040).
+class I2CEngine{
+    private:
+        I2CTransport *_transport;
+        QueueHandle_t _queues[I2C_NUM_PRIORITIES]; // Ponteiros para i2c_transaction_t
+        TaskHandle_t _task;
+        KernelQueue<I2C_ENGINE_QUEUE_LENGTH, sizeof(i2c_transaction_t *)> _queueMemory[I2C_NUM_PRIORITIES];
+        KernelTask<I2C_ENGINE_STACK> _taskMemory;
+        uint32_t _errors;
+
+        int execute(i2c_transaction_t *t);
+
+    public:
+        // Construtor
+        I2CEngine(I2CTransport *transport);
+
+        // Metodos
+        bool begin(UBaseType_t priority, UBaseType_t affinity = tskNO_AFFINITY); // Inicializa o transporte e a task
+        bool submit(i2c_transaction_t *t, uint8_t priority); // Assincrono: fim por notificacao ou callback
+        int transfer(uint8_t address, const uint8_t *tx, uint16_t tx_len, uint8_t *rx, uint16_t rx_len, uint8_t priority = I2C_PRIORITY_NORMAL); // Sincrono
+        uint32_t getErrors();
+        static I2CEngine *getDefault();
+
+        // Função estática que será a Task do FreeRTOS
+        static void taskImpl(void *_this);
+};
+
+#endif // __cplusplus
+
+#endif
@@ -0,0 +1,82 @@
+#include "KernelMemory.h"
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+typedef struct{
+    const char *name;
+    uint32_t bytes;
+} kernel_memory_entry_t;
+
+static kernel_memory_entry_t entries[KERNEL_MEMORY_MAX_OBJECTS];
+static uint32_t entry_count = 0;
+static uint32_t entry_total = 0; // Inclui os que nao couberam no mapa
+
+void kernel_memory_record(const char *name, size_t bytes){
+    taskENTER_CRITICAL();
+    if(entry_count < KERNEL_MEMORY_MAX_OBJECTS){
+        entries[entry_count].name = name;
+        entries[entry_count].bytes = bytes;
+        entry_count++;
+    }
+    entry_total += bytes;
+    taskEXIT_CRITICAL();
+}
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+
+// Tasks do proprio kernel: uma idle por nucleo e o daemon dos timers
+template<configSTACK_DEPTH_TYPE Depth>
+struct kernel_task_memory_t{
+    StackType_t stack[Depth] __attribute__((aligned(8)));
+    StaticTask_t tcb;
+};
+
+static kernel_task_memory_t<configMINIMAL_STACK_SIZE> idleMemory[configNUMBER_OF_CORES] KERNEL_MEMORY(kernel);
+static kernel_task_memory_t<configTIMER_TASK_STACK_DEPTH> timerMemory KERNEL_MEMORY(kernel);
+
+extern "C" void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *depth){
+    *tcb = &idleMemory[0].tcb;
+    *stack = idleMemory[0].stack;
+    *depth = configMINIMAL_STACK_SIZE;
+}
+
+#if (configNUMBER_OF_CORES > 1)
+extern "C" void vApplicationGetPassiveIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *depth,
+                                                     BaseType_t index){
+    *tcb = &idleMemory[index + 1].tcb;
+    *stack = idleMemory[index + 1].stack;
+    *depth = configMINIMAL_STACK_SIZE;
+}
+#endif
+
+extern "C" void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *depth){
+    *tcb = &timerMemory.tcb;
+    *stack = timerMemory.stack;
+    *depth = configTIMER_TASK_STACK_DEPTH;
+}
+
+#endif
+
+#if (configUSE_MALLOC_FAILED_HOOK == 1)
+// O heap_4 chama isso quando um pvPortMalloc falha: sem memoria para um objeto
+// do kernel o firmware nao teria como seguir, melhor parar com a causa na serial
+extern "C" void vApplicationMallocFailedHook(void){
+    panic("[KMEM] Heap do FreeRTOS esgotado (%lu livres, minimo %lu)", (unsigned long)xPortGetFreeHeapSize(),
+          (unsigned long)xPortGetMinimumEverFreeHeapSize());
+}
+#endif
+
+void kernel_memory_print(){
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    printf("[KMEM] Objetos do kernel em memoria estatica:\n");
+    printf("[KMEM]   %-16s %6lu\n", "Idle", (unsigned long)sizeof(idleMemory));
+    printf("[KMEM]   %-16s %6lu\n", "Timers", (unsigned long)sizeof(timerMemory));
+    for(uint32_t i = 0; i < entry_count; i++){
+        printf("[KMEM]   %-16s %6lu\n", entries[i].name, (unsigned long)entries[i].bytes);
+    }
+    printf("[KMEM] Total %lu bytes\n", (unsigned long)(entry_total + sizeof(idleMemory) + sizeof(timerMemory)));
+#endif
+    printf("[KMEM] Heap do FreeRTOS: %lu de %lu bytes livres\n", (unsigned long)xPortGetFreeHeapSize(),
+           (unsigned long)configTOTAL_HEAP_SIZE);
+}
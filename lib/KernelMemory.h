@@ -0,0 +1,98 @@
+#ifndef KERNELMEMORY_H
+#define KERNELMEMORY_H
+
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "CoreAffinity.h"
+
+// Memoria dos objetos do kernel. Com FREERTOS_STATIC (CMake) cada task, fila e
+// mutex carrega a propria pilha/area e o bloco de controle e e criado pelas
+// APIs ...Static: nada sai do heap_4 e a RAM fica fixa desde o link. Sem a
+// opcao os objetos ficam vazios e criam pelo heap, como antes.
+//
+// KERNEL_MEMORY(subsistema) poe o objeto na secao .bss.kmem.<subsistema>.<linha>:
+// o kernel_memory_report.cmake soma essas secoes no mapa do link e falha o
+// build acima do orcamento do subsistema (KMEM_BUDGETS no CMakeLists.txt).
+// Uma secao por objeto: os que nao sao usados saem no --gc-sections.
+#define KMEM_STR2(x) #x
+#define KMEM_STR(x) KMEM_STR2(x)
+#define KERNEL_MEMORY(subsystem) __attribute__((section(".bss.kmem." #subsystem "." KMEM_STR(__LINE__))))
+
+#define KERNEL_MEMORY_MAX_OBJECTS 16 // Linhas do mapa impresso no boot
+
+// Registro para o mapa do boot (chamado pelos create)
+void kernel_memory_record(const char *name, size_t bytes);
+// Imprime os objetos estaticos criados ate agora e o heap_4 que sobra
+void kernel_memory_print();
+
+// Task com pilha de Depth palavras
+template<configSTACK_DEPTH_TYPE Depth>
+class KernelTask{
+    private:
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+        StackType_t _stack[Depth] __attribute__((aligned(8))); // AAPCS: pilha alinhada em 8
+        StaticTask_t _tcb;
+#endif
+
+    public:
+        // Mesmos parametros do xTaskCreatePinned, com a pilha no template
+        BaseType_t create(TaskFunction_t code, const char *name, void *params, UBaseType_t priority,
+                          TaskHandle_t *handle = NULL, UBaseType_t affinity = tskNO_AFFINITY){
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+            TaskHandle_t task = xTaskCreateStaticPinned(code, name, Depth, params, priority, _stack, &_tcb, affinity);
+            if(handle != NULL) *handle = task;
+            if(task == NULL) return pdFAIL;
+            kernel_memory_record(name, sizeof(*this));
+            return pdPASS;
+#else
+            return xTaskCreatePinned(code, name, Depth, params, priority, handle, affinity);
+#endif
+        }
+};
+
+// Fila de Length itens de ItemSize bytes
+template<UBaseType_t Length, UBaseType_t ItemSize>
+class KernelQueue{
+    private:
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+        uint8_t _storage[Length * ItemSize];
+        StaticQueue_t _queue;
+#endif
+
+    public:
+        // O nome vai para o registro de filas (depurador) e para o mapa do boot
+        QueueHandle_t create(const char *name){
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+            QueueHandle_t queue = xQueueCreateStatic(Length, ItemSize, _storage, &_queue);
+            if(queue != NULL) kernel_memory_record(name, sizeof(*this));
+#else
+            QueueHandle_t queue = xQueueCreate(Length, ItemSize);
+#endif
+            if(queue != NULL) vQueueAddToRegistry(queue, name);
+            return queue;
+        }
+};
+
+class KernelMutex{
+    private:
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+        StaticSemaphore_t _mutex;
+#endif
+
+    public:
+        SemaphoreHandle_t create(const char *name){
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+            SemaphoreHandle_t mutex = xSemaphoreCreateMutexStatic(&_mutex);
+            if(mutex != NULL) kernel_memory_record(name, sizeof(*this));
+#else
+            SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+#endif
+            if(mutex != NULL) vQueueAddToRegistry(mutex, name);
+            return mutex;
+        }
+};
+
+#endif
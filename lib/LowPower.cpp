@@ -0,0 +1,142 @@
+#include "LowPower.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if (configUSE_TICKLESS_IDLE == 2)
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/clocks.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/systick.h"
+
+#define LOW_POWER_US_PER_TICK (1000000u / configTICK_RATE_HZ)
+#define LOW_POWER_MAX_SLEEP_TICKS pdMS_TO_TICKS(60 * 60 * 1000) // Sem prazo nenhum, acorda a cada hora
+
+// Clocks cortados no deep sleep: perifericos que o firmware nao usa (ADC, RTC,
+// PWM, SPI, UART1, I2C1, JTAG, TBMAN). Timer, GPIO, DMA, I2C0, PIO (cyw43 e
+// HX711), UART0 e USB (stdio) continuam com clock
+#define LOW_POWER_GATED_EN0 (CLOCKS_SLEEP_EN0_CLK_ADC_ADC_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_ADC_BITS |     \
+                             CLOCKS_SLEEP_EN0_CLK_RTC_RTC_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_RTC_BITS |     \
+                             CLOCKS_SLEEP_EN0_CLK_SYS_PWM_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_JTAG_BITS |    \
+                             CLOCKS_SLEEP_EN0_CLK_SYS_SPI0_BITS | CLOCKS_SLEEP_EN0_CLK_PERI_SPI0_BITS |  \
+                             CLOCKS_SLEEP_EN0_CLK_SYS_SPI1_BITS | CLOCKS_SLEEP_EN0_CLK_PERI_SPI1_BITS |  \
+                             CLOCKS_SLEEP_EN0_CLK_SYS_I2C1_BITS)
+#define LOW_POWER_GATED_EN1 (CLOCKS_SLEEP_EN1_CLK_SYS_UART1_BITS | CLOCKS_SLEEP_EN1_CLK_PERI_UART1_BITS | \
+                             CLOCKS_SLEEP_EN1_CLK_SYS_TBMAN_BITS)
+
+static int alarm_num = -1;
+// So a idle escreve, com as interrupcoes desligadas
+static low_power_stats_t stats = {0, 0, 0};
+
+static void low_power_alarm(uint alarm){
+    (void)alarm; // So acorda o nucleo: o tick e acertado na volta do sono
+}
+
+// O sistema so corta os clocks com os dois nucleos em deep sleep: o nucleo 1
+// (sem uso com um nucleo so) fica parado em deep sleep, rodando da RAM para
+// nao depender do XIP durante as gravacoes na flash
+static void __not_in_flash_func(low_power_park_core1)(){
+    scb_hw->scr |= M0PLUS_SCR_SLEEPDEEP_BITS;
+    while(true) __wfi(); // Nenhuma IRQ habilitada neste nucleo
+}
+
+void low_power_begin(void){
+    alarm_num = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_num, low_power_alarm);
+
+    clocks_hw->sleep_en0 &= ~LOW_POWER_GATED_EN0;
+    clocks_hw->sleep_en1 &= ~LOW_POWER_GATED_EN1;
+    multicore_launch_core1(low_power_park_core1);
+}
+
+void low_power_get_stats(low_power_stats_t *copy){
+    taskENTER_CRITICAL();
+    *copy = stats;
+    taskEXIT_CRITICAL();
+}
+
+// Substitui a versao do port (configUSE_TICKLESS_IDLE == 1), limitada pelos
+// 24 bits do SysTick a ~134 ms a 125 MHz e sem o deep sleep. Chamada pela idle
+// com o scheduler suspenso
+extern "C" void vPortSuppressTicksAndSleep(TickType_t expected){
+    if(alarm_num < 0) return;
+    if(expected > LOW_POWER_MAX_SLEEP_TICKS) expected = LOW_POWER_MAX_SLEEP_TICKS;
+
+    // Nada de taskENTER_CRITICAL: o PRIMASK deixa as IRQs acordarem o nucleo,
+    // que so as atende depois de acertar o tick
+    uint32_t interrupts = save_and_disable_interrupts();
+    if(eTaskConfirmSleepModeStatus() == eAbortSleep){
+        stats.aborted++;
+        restore_interrupts(interrupts);
+        return;
+    }
+
+    // Para o SysTick e acha o inicio do tick atual no timer de 1 MHz
+    uint32_t counts = systick_hw->rvr + 1; // Contagens por tick
+    systick_hw->csr &= ~M0PLUS_SYST_CSR_ENABLE_BITS;
+    if(scb_hw->icsr & M0PLUS_ICSR_PENDSTSET_BITS){
+        // O tick venceu agora: ele e atendido ao religar as interrupcoes
+        systick_hw->csr |= M0PLUS_SYST_CSR_ENABLE_BITS;
+        stats.aborted++;
+        restore_interrupts(interrupts);
+        return;
+    }
+    uint64_t start = time_us_64();
+    uint64_t tick_start = start - ((uint64_t)(systick_hw->rvr - systick_hw->cvr) * LOW_POWER_US_PER_TICK) / counts;
+
+    // Acorda na fronteira do tick em que a proxima task vence
+    absolute_time_t wake;
+    update_us_since_boot(&wake, tick_start + (uint64_t)expected * LOW_POWER_US_PER_TICK);
+    if(hardware_alarm_set_target(alarm_num, wake)){
+        // Prazo ja passou
+        systick_hw->csr |= M0PLUS_SYST_CSR_ENABLE_BITS;
+        stats.aborted++;
+        restore_interrupts(interrupts);
+        return;
+    }
+
+    scb_hw->scr |= M0PLUS_SCR_SLEEPDEEP_BITS;
+    __dsb();
+    __wfi();
+    scb_hw->scr &= ~M0PLUS_SCR_SLEEPDEEP_BITS;
+    hardware_alarm_cancel(alarm_num);
+
+    // Ticks inteiros que passaram no sono (um GPIO pode ter acordado antes do alarme)
+    uint64_t now = time_us_64();
+    uint64_t elapsed = now - tick_start;
+    TickType_t ticks = (TickType_t)(elapsed / LOW_POWER_US_PER_TICK);
+    if(ticks > expected) ticks = expected;
+
+    // O SysTick volta com o que falta do tick atual e depois com o periodo normal
+    uint64_t phase = elapsed - (uint64_t)ticks * LOW_POWER_US_PER_TICK;
+    uint32_t remaining = phase < LOW_POWER_US_PER_TICK ? (uint32_t)(((LOW_POWER_US_PER_TICK - phase) * counts) / LOW_POWER_US_PER_TICK) : 0;
+    if(remaining < 2) remaining = 2;
+    systick_hw->rvr = remaining - 1;
+    systick_hw->cvr = 0;
+    systick_hw->csr |= M0PLUS_SYST_CSR_ENABLE_BITS;
+    vTaskStepTick(ticks);
+    systick_hw->rvr = counts - 1;
+
+    stats.sleep_us += now - start;
+    stats.sleeps++;
+    restore_interrupts(interrupts);
+}
+
+#else
+
+void low_power_begin(void){
+}
+
+void low_power_get_stats(low_power_stats_t *copy){
+    copy->sleep_us = 0;
+    copy->sleeps = 0;
+    copy->aborted = 0;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef LOWPOWER_H
+#define LOWPOWER_H
+
+#include <stdint.h>
+
+// Tickless idle (FREERTOS_TICKLESS, so com um nucleo): sem tasks prontas, a
+// idle para o SysTick e dorme ate a proxima task com prazo. O prazo fica num
+// alarme do timer de 1 MHz, que continua contando no sono, e o nucleo entra em
+// deep sleep: o SLEEP_EN corta o clock dos perifericos sem uso. Acordam o
+// nucleo o alarme, os INT dos MCP23017 (IRQ de GPIO) e as demais IRQs (cyw43,
+// I2C, USB). O dormant nao serve: ele para o timer e o radio.
+
+typedef struct{
+    uint64_t sleep_us; // Tempo total dormindo desde o boot
+    uint32_t sleeps;   // Entradas no sono
+    uint32_t aborted;  // Desistencias (task pronta ou tick pendente na entrada)
+} low_power_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Antes do vTaskStartScheduler: alarme de despertar, clocks do sono e nucleo 1
+void low_power_begin(void);
+// Contadores acumulados (zerados sem FREERTOS_TICKLESS)
+void low_power_get_stats(low_power_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,55 +1,73 @@
 #include "MCP23017.h"
 
-#include "hardware/i2c.h"
+#include "I2CEngine.h"
 
 MCP23017::MCP23017(uint8_t addr, int int_pin) : _address(addr), _interrupt_pin(int_pin){
     _portA.iodir = 0b11111111; // Todos como entrada
     _portB.iodir = 0b11111111; // Todos como entrada
+    _service_us = 0;
+    _service_max_us = 0;
 }
 
 void MCP23017::init(){
-    // Definindo a direcao dos pinos e habilitando pull-ups
-    writeRegister(MCP_IODIRA, _portA.iodir);
-    writeRegister(MCP_GPPUA, _portA.iodir);
-    writeRegister(MCP_IODIRB, _portB.iodir);
-    writeRegister(MCP_GPPUB, _portB.iodir);
-
-    // Configurando interrupçoes
-    // Ativa o modo espalhado: MIRROR = 1 (bit 6)
-    writeRegister(MCP_IOCON, 0b01000000);
-    // Habilita interrupções para PORTA e PORTB
-    writeRegister(MCP_IODIRA, 0xFF);
-    writeRegister(MCP_GPPUA, 0xFF);
-    writeRegister(MCP_GPINTENA, 0xFF);
-    writeRegister(MCP_INTCONA, 0x00); // habilita a comparação com o registrador "DEF_VAL"
-    writeRegister(MCP_DEFVALA, 0xFF); // Definir DEFVAL = 1 (interrupção quando GPA0 cair para 0 → borda de descida)
-
-    writeRegister(MCP_IODIRB, 0xFF);
-    writeRegister(MCP_GPPUB, 0xFF);
-    writeRegister(MCP_GPINTENB, 0xFF);
-    writeRegister(MCP_INTCONB, 0x00); // habilita a comparação com o registrador "DEF_VAL"
-    writeRegister(MCP_DEFVALB, 0xFF);
+    // Com IOCON.BANK = 0 e SEQOP = 0 os registradores 0x00 a 0x0D sao consecutivos e o
+    // endereco auto-incrementa, entao toda a configuracao vai numa unica escrita
+    uint8_t config[MCP_GPPUB + 1];
+    config[MCP_IODIRA] = _portA.iodir; // Direcao dos pinos
+    config[MCP_IODIRB] = _portB.iodir;
+    config[MCP_IPOLA] = 0x00; // Sem inversao de polaridade
+    config[MCP_IPOLB] = 0x00;
+    config[MCP_GPINTENA] = 0xFF; // Habilita interrupções para PORTA e PORTB
+    config[MCP_GPINTENB] = 0xFF;
+    config[MCP_DEFVALA] = 0xFF; // Definir DEFVAL = 1 (interrupção quando GPA0 cair para 0 → borda de descida)
+    config[MCP_DEFVALB] = 0xFF;
+    config[MCP_INTCONA] = 0x00; // habilita a comparação com o registrador "DEF_VAL"
+    config[MCP_INTCONB] = 0x00;
+    // Ativa o modo espelhado (MIRROR), mantendo BANK = 0 e o auto-incremento (SEQOP = 0)
+    // IOCON aparece nos enderecos 0x0A e 0x0B
+    config[MCP_IOCON] = MCP_IOCON_MIRROR;
+    config[MCP_IOCON + 1] = MCP_IOCON_MIRROR;
+    config[MCP_GPPUA] = _portA.iodir; // Pull-ups nas entradas
+    config[MCP_GPPUB] = _portB.iodir;
+    writeRegisters(MCP_IODIRA, config, sizeof(config));
 
     // Limpa interrupcoes pendentes
-    readRegister(MCP_IODIRA);
-    readRegister(MCP_IODIRB);
+    handle_flags();
 }
 
+// Todo acesso passa pelo I2CEngine com prioridade alta: o atendimento das
+// interrupcoes dos sensores de passagem fura a fila das medicoes lentas
 void MCP23017::writeRegister(uint8_t reg, uint8_t value){
     uint8_t data[2] = {reg, value};
-    i2c_write_blocking(I2C_PORT, _address, data, 2, false);
+    i2c_engine_transfer(_address, data, 2, NULL, 0, I2C_PRIORITY_HIGH);
 }
 
 uint8_t MCP23017::readRegister(uint8_t reg){
-    uint8_t value;
-    i2c_write_blocking(I2C_PORT, _address, &reg, 1, true);
-    i2c_read_blocking(I2C_PORT, _address, &value, 1, false);
+    uint8_t value = 0;
+    i2c_engine_transfer(_address, &reg, 1, &value, 1, I2C_PRIORITY_HIGH);
     return value;
 }
 
+bool MCP23017::writeRegisters(uint8_t reg, const uint8_t *values, uint8_t len){
+    uint8_t data[MCP_NUM_REGISTERS + 1];
+    if(len > MCP_NUM_REGISTERS) return false;
+
+    data[0] = reg;
+    for(int i = 0; i < len; i++)
+        data[i + 1] = values[i];
+    return i2c_engine_transfer(_address, data, len + 1, NULL, 0, I2C_PRIORITY_HIGH) == len + 1;
+}
+
+bool MCP23017::readRegisters(uint8_t reg, uint8_t *values, uint8_t len){
+    // Endereco e leitura com repeated start: o MCP23017 auto-incrementa o endereco
+    return i2c_engine_transfer(_address, &reg, 1, values, len, I2C_PRIORITY_HIGH) == len + 1;
+}
+
 void MCP23017::readGPIO(){
-    _portA.state = readRegister(MCP_GPIOA);
-    _portB.state = readRegister(MCP_GPIOB);
+    uint8_t gpio[2];
+    readRegisters(MCP_GPIOA, gpio, 2);
+    _portA.state = gpio[0];
+    _portB.state = gpio[1];
 }
 
 uint8_t MCP23017::getPortAState(){
@@ -84,9 +102,29 @@ uint8_t MCP23017::getInterruptPin(){
     return _interrupt_pin;
 }
 
+uint32_t MCP23017::getServiceTime(){
+    return _service_us;
+}
+
+uint32_t MCP23017::getServiceTimeMax(){
+    return _service_max_us;
+}
+
 void MCP23017::handle_flags(){
-    _intfA = readRegister(MCP_INTFA);
-    _intfB = readRegister(MCP_INTFB);
-    _capA = readRegister(MCP_INTCAPA);
-    _capB = readRegister(MCP_INTCAPB);
+    // INTFA, INTFB, INTCAPA e INTCAPB sao consecutivos (0x0E a 0x11): uma unica
+    // leitura em rajada no lugar de quatro pares escrita/leitura
+    uint32_t start = time_us_32();
+    uint8_t flags[4];
+    if(readRegisters(MCP_INTFA, flags, 4)){
+        _intfA = flags[0];
+        _intfB = flags[1];
+        _capA = flags[2];
+        _capB = flags[3];
+    } else {
+        _intfA = 0;
+        _intfB = 0;
+    }
+
+    _service_us = time_us_32() - start;
+    if(_service_us > _service_max_us) _service_max_us = _service_us;
 }
@@ -3,10 +3,6 @@
 
 #include "pico/stdlib.h"
 
-#define I2C_PORT i2c0
-#define I2C_SDA 0
-#define I2C_SCL 1
-
 // Pinos do MCP23017
 #define GPA0 0
 #define GPA1 1          
@@ -25,13 +21,15 @@
 #define GPB6 14
 #define GPB7 15
 
-// Registradores do MCP23017 para PORTA
+// Registradores do MCP23017 para PORTA (enderecos com IOCON.BANK = 0)
 #define MCP_IODIRA 0x00
+#define MCP_IPOLA 0x02
 #define MCP_GPPUA 0x0C
 #define MCP_GPIOA 0x12
 
 // Registradores do MCP23017 para PORTB 
 #define MCP_IODIRB 0x01
+#define MCP_IPOLB 0x03
 #define MCP_GPPUB 0x0D
 #define MCP_GPIOB 0x13
 
@@ -48,6 +46,11 @@
 #define MCP_INTCAPB 0x11 // Captura o estado e limpa a interrupção
 
 #define MCP_IOCON 0x0A
+// Bits do IOCON
+#define MCP_IOCON_BANK 0x80   // 0 = registradores A/B intercalados (enderecos sequenciais)
+#define MCP_IOCON_MIRROR 0x40 // INTA e INTB espelhados
+#define MCP_IOCON_SEQOP 0x20  // 1 = desabilita o auto-incremento do endereco
+#define MCP_NUM_REGISTERS 0x16 // Registradores 0x00 a 0x15 no modo BANK = 0
 
 
 typedef struct{
@@ -64,6 +67,7 @@ class MCP23017{
         MCP23017_PortInfo _portB; // Informações da PORTB
         uint8_t _intfA, _intfB;
         uint8_t _capA, _capB; 
+        uint32_t _service_us, _service_max_us; // Duracao do handle_flags (ultima e maxima)
     public:
         // Construtor
         MCP23017(uint8_t addr, int int_pin);
@@ -73,6 +77,8 @@ class MCP23017{
         void init(); // Inicializa o MCP23017
         void writeRegister(uint8_t reg, uint8_t value); // Escreve em um registrador
         uint8_t readRegister(uint8_t reg); // Le um registrador
+        bool writeRegisters(uint8_t reg, const uint8_t *values, uint8_t len); // Escreve registradores consecutivos numa unica transacao
+        bool readRegisters(uint8_t reg, uint8_t *values, uint8_t len); // Le registradores consecutivos numa unica transacao
         void readGPIO(); // Le o estado dos pinos GPIO
         // Getters
         uint8_t getPortAState(); // Retorna o estado atual do PortA
@@ -83,6 +89,8 @@ class MCP23017{
         uint8_t getCapB();
         uint8_t getAddress();
         uint8_t getInterruptPin();
+        uint32_t getServiceTime(); // Duracao do ultimo handle_flags (us)
+        uint32_t getServiceTimeMax(); // Maior duracao do handle_flags (us)
 
         void handle_flags(); // Atualiza as flags do PortA e PortB
 };
@@ -1,14 +1,47 @@
 // lib/MqttClient.cpp
 #include "MqttClient.h"
+#include "WallClock.h"
+#include "lwip/netif.h"
+#include "lwip/dns.h"
+#include "pico/rand.h"
 #include <string.h>
 #include <stdio.h>
 
+// Instancia para os callbacks do netif, que nao recebem argumento
+static MqttClient* instance = NULL;
+
 // Construtor
 MqttClient::MqttClient() {
     client = NULL;
     connected = false;
-    wifiConnected = false;
-    msgQueue = NULL;
+    connecting = false;
+    linkLost = false;
+    dnsResult = 0;
+    state = MQTT_STATE_WIFI_JOIN;
+    stateSince = 0;
+    retryAt = 0;
+    backoffMs = MQTT_BACKOFF_MIN_MS;
+    attemptStart = 0;
+    outageStart = 0;
+    brokerResolved = false;
+    brokerFailures = 0;
+    wifiStarted = false;
+    topicCount = 0;
+    task = NULL;
+    completed = 0;
+    failed = 0;
+    completedSeen = 0;
+    failedSeen = 0;
+    memset(&stats, 0, sizeof(stats));
+#ifdef MQTT_FLASH_OUTBOX
+    for (int i = 0; i < MQTT_REQ_MAX_IN_FLIGHT; i++) {
+        replaySlots[i].self = this;
+        replaySlots[i].state = MQTT_REPLAY_FREE;
+    }
+    replayPage = 0;
+    replayRewind = false;
+    flashOutboxReady = false;
+#endif
     
     // Configura infos do cliente
     memset(&clientInfo, 0, sizeof(clientInfo));
@@ -19,23 +52,47 @@ MqttClient::MqttClient() {
 }
 
 bool MqttClient::begin() {
-    // Inicializa fila
-    msgQueue = xQueueCreate(MQTT_MSG_QUEUE_SIZE, sizeof(MqttMessage));
-    if (msgQueue == NULL) {
-        printf("[MQTT] Erro ao criar fila\n");
-        return false;
-    }
-
     // Inicializa Wi-Fi (CYW43)
     if (cyw43_arch_init()) {
         printf("[MQTT] Falha ao iniciar hardware Wi-Fi\n");
         return false;
     }
     cyw43_arch_enable_sta_mode();
+    instance = this;
+
+#ifdef MQTT_CERT_INC
+    if (!tls.begin()) return false;
+    clientInfo.tls_config = tls.config();
+#endif
+
+    // Queda do link e IP obtido acordam a task, sem consultar o cyw43 em loop
+    cyw43_arch_lwip_begin();
+    netif_set_link_callback(&cyw43_state.netif[CYW43_ITF_STA], netifLinkCb);
+    netif_set_status_callback(&cyw43_state.netif[CYW43_ITF_STA], netifStatusCb);
+    cyw43_arch_lwip_end();
+
+#ifdef MQTT_FLASH_OUTBOX
+    // Mensagens que ficaram na flash antes do reset sao enviadas primeiro
+    // Se a regiao do log nao confere, fica so a fila da RAM
+    flashOutboxReady = flashOutbox.begin();
+    replayPage = flashOutbox.oldest();
+#endif
 
     return true;
 }
 
+void MqttClient::notify(uint32_t events) {
+    if (task == NULL) return;
+    // Os callbacks do lwIP rodam na IRQ de background do cyw43
+    if (portCHECK_IF_IN_ISR()) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xTaskNotifyFromISR(task, events, eSetBits, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    } else {
+        xTaskNotify(task, events, eSetBits);
+    }
+}
+
 // === Callbacks Estáticos (Ponte entre C e C++) ===
 void MqttClient::mqttConnectionCb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status) {
     MqttClient* self = (MqttClient*)arg; // Recupera a instância da classe
@@ -47,97 +104,491 @@ void MqttClient::mqttConnectionCb(mqtt_client_t *client, void *arg, mqtt_connect
         printf("[MQTT] Erro na conexão: %d\n", status);
         self->connected = false;
     }
+    self->connecting = false;
+    self->notify(MQTT_EVENT_CONNECTION);
 }
 
 void MqttClient::mqttPubRequestCb(void *arg, err_t result) {
+    MqttClient* self = (MqttClient*)arg;
     if (result != ERR_OK) {
         printf("[MQTT] Falha ao publicar: %d\n", result);
+        self->failed++;
     }
+    // Conclusoes chegam na ordem de envio: a task libera a mensagem mais antiga em voo
+    self->completed++;
+    self->notify(MQTT_EVENT_SENT);
 }
 
-// === Lógica Principal ===
-void MqttClient::connectWifi() {
-    if (cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP) {
-        wifiConnected = true;
-        return;
+void MqttClient::netifLinkCb(struct netif *netif) {
+    if (instance == NULL) return;
+    if (!netif_is_link_up(netif)) {
+        printf("[WIFI] Link perdido\n");
+        instance->linkLost = true;
     }
-    
-    printf("[WIFI] Conectando a %s...\n", WIFI_SSID);
-    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASS, CYW43_AUTH_WPA2_AES_PSK, 10000)) {
-        printf("[WIFI] Falha na conexão. Tentando novamente...\n");
-        wifiConnected = false;
+    instance->notify(MQTT_EVENT_LINK);
+}
+
+void MqttClient::netifStatusCb(struct netif *netif) {
+    if (instance != NULL) instance->notify(MQTT_EVENT_LINK);
+}
+
+void MqttClient::dnsFoundCb(const char *name, const ip_addr_t *ipaddr, void *arg) {
+    MqttClient* self = (MqttClient*)arg;
+    if (ipaddr != NULL) {
+        self->brokerAddr = *ipaddr;
+        self->dnsResult = 1;
     } else {
-        printf("[WIFI] Conectado! IP obtido.\n");
-        wifiConnected = true;
+        self->dnsResult = -1;
     }
+    self->notify(MQTT_EVENT_DNS);
+}
+
+// === Lógica Principal ===
+void MqttClient::enterState(MqttConnState next) {
+    state = next;
+    stateSince = xTaskGetTickCount();
 }
 
-void MqttClient::connectBroker() {
-    if (client == NULL) {
-        client = mqtt_client_new();
+void MqttClient::backoff(const char* reason) {
+    // Jitter de +-25%: varios nos nao voltam todos juntos depois que o AP reinicia
+    uint32_t jitter = backoffMs / 4;
+    uint32_t delay = backoffMs - jitter + get_rand_32() % (2 * jitter + 1);
+    printf("%s. Nova tentativa em %lu ms\n", reason, (unsigned long)delay);
+    retryAt = xTaskGetTickCount() + pdMS_TO_TICKS(delay);
+    backoffMs = (backoffMs * 2 < MQTT_BACKOFF_MAX_MS) ? backoffMs * 2 : MQTT_BACKOFF_MAX_MS;
+    stats.connectFailures++;
+    enterState(MQTT_STATE_BACKOFF);
+}
+
+TickType_t MqttClient::runConnection() {
+    // Queda do link em qualquer estado: volta para a associacao
+    if (linkLost) {
+        linkLost = false;
+        if (state == MQTT_STATE_CONNECTED || state == MQTT_STATE_BROKER_WAIT) {
+            // Sem link a sessao TCP nao volta: fecha agora em vez de esperar o timeout
+            cyw43_arch_lwip_begin();
+            mqtt_disconnect(client);
+            cyw43_arch_lwip_end();
+            connected = false;
+            connecting = false;
+        }
+        if (state == MQTT_STATE_CONNECTED) outageStart = xTaskGetTickCount();
+        backoffMs = MQTT_BACKOFF_MIN_MS; // Link que volta costuma voltar rapido
+        attemptStart = xTaskGetTickCount();
+        enterState(MQTT_STATE_WIFI_JOIN);
     }
 
-    if (!connected && wifiConnected) {
-        ip_addr_t brokerIp;
-        if (!ip4addr_aton(MQTT_BROKER_IP, &brokerIp)) {
-            printf("[MQTT] IP do broker invalido\n");
-            return;
+    while (true) {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t elapsed = now - stateSince;
+
+        switch (state) {
+        case MQTT_STATE_BACKOFF:
+            if ((int32_t)(retryAt - now) > 0) return retryAt - now;
+            attemptStart = now;
+            enterState(cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP ?
+                       MQTT_STATE_DNS : MQTT_STATE_WIFI_JOIN);
+            break;
+
+        case MQTT_STATE_WIFI_JOIN:
+            if (cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP) {
+                enterState(MQTT_STATE_DNS);
+                break;
+            }
+            printf("[WIFI] Conectando a %s...\n", WIFI_SSID);
+            if (cyw43_arch_wifi_connect_async(WIFI_SSID, WIFI_PASS, CYW43_AUTH_WPA2_AES_PSK)) {
+                backoff("[WIFI] Falha ao iniciar a associacao");
+                break;
+            }
+            enterState(MQTT_STATE_WIFI_WAIT);
+            break;
+
+        case MQTT_STATE_WIFI_WAIT: {
+            int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+            if (status == CYW43_LINK_UP) {
+                printf("[WIFI] Conectado! IP obtido em %lu ms.\n", (unsigned long)pdTICKS_TO_MS(elapsed));
+                if (!wifiStarted) {
+                    wifiStarted = true;
+                    wall_clock_start(); // Hora real via SNTP (so inicia na primeira conexao)
+                }
+                enterState(MQTT_STATE_DNS);
+                break;
+            }
+            if (status < 0 || elapsed >= pdMS_TO_TICKS(MQTT_WIFI_JOIN_TIMEOUT_MS)) {
+                backoff("[WIFI] Falha na conexão");
+                break;
+            }
+            // O cyw43 nao avisa falha de associacao: consulta periodica so neste estado
+            return pdMS_TO_TICKS(MQTT_WIFI_POLL_MS);
+        }
+
+        case MQTT_STATE_DNS: {
+            if (brokerResolved) {
+                enterState(MQTT_STATE_BROKER);
+                break;
+            }
+            dnsResult = 0;
+            cyw43_arch_lwip_begin();
+            err_t err = dns_gethostbyname(MQTT_BROKER_HOST, &brokerAddr, dnsFoundCb, this);
+            cyw43_arch_lwip_end();
+            if (err == ERR_OK) {
+                brokerResolved = true; // IP literal ou cache do lwIP
+                enterState(MQTT_STATE_BROKER);
+            } else if (err == ERR_INPROGRESS) {
+                enterState(MQTT_STATE_DNS_WAIT);
+            } else {
+                backoff("[MQTT] Falha no DNS");
+            }
+            break;
         }
 
-        printf("[MQTT] Conectando ao Broker %s...\n", MQTT_BROKER_IP);
-        // Passamos 'this' como último argumento para recuperá-lo no callback
-        mqtt_client_connect(client, &brokerIp, BROKER_PORT, mqttConnectionCb, this, &clientInfo);
+        case MQTT_STATE_DNS_WAIT:
+            if (dnsResult > 0) {
+                brokerResolved = true;
+                printf("[MQTT] Broker %s em %s\n", MQTT_BROKER_HOST, ipaddr_ntoa(&brokerAddr));
+                enterState(MQTT_STATE_BROKER);
+            } else if (dnsResult < 0 || elapsed >= pdMS_TO_TICKS(MQTT_DNS_TIMEOUT_MS)) {
+                backoff("[MQTT] Broker nao resolvido");
+            } else {
+                return pdMS_TO_TICKS(MQTT_DNS_TIMEOUT_MS) - elapsed;
+            }
+            break;
+
+        case MQTT_STATE_BROKER: {
+            if (client == NULL) {
+                client = mqtt_client_new();
+            }
+            printf("[MQTT] Conectando ao Broker %s...\n", MQTT_BROKER_HOST);
+            // Passamos 'this' como último argumento para recuperá-lo no callback
+            connecting = true;
+            cyw43_arch_lwip_begin();
+            err_t err = mqtt_client_connect(client, &brokerAddr, BROKER_PORT, mqttConnectionCb, this, &clientInfo);
+#ifdef MQTT_CERT_INC
+            // O TCP ainda nao conectou: SNI e sessao do cache entram antes do handshake
+            if (err == ERR_OK) tls.connecting(client, MQTT_BROKER_HOST);
+#endif
+            cyw43_arch_lwip_end();
+            if (err != ERR_OK) {
+                connecting = false;
+                backoff("[MQTT] Falha ao abrir a conexao");
+                break;
+            }
+            enterState(MQTT_STATE_BROKER_WAIT);
+            break;
+        }
+
+        case MQTT_STATE_BROKER_WAIT:
+            if (connected) {
+#ifdef MQTT_CERT_INC
+                cyw43_arch_lwip_begin();
+                tls.connected(client, pdTICKS_TO_MS(elapsed));
+                cyw43_arch_lwip_end();
+#endif
+                stats.reconnects++;
+                stats.lastConnectMs = pdTICKS_TO_MS(now - attemptStart);
+                if (outageStart != 0) {
+                    stats.lastOutageMs = pdTICKS_TO_MS(now - outageStart);
+                    printf("[MQTT] Reconectado apos %lu ms fora\n", (unsigned long)stats.lastOutageMs);
+                }
+                backoffMs = MQTT_BACKOFF_MIN_MS;
+                brokerFailures = 0;
+                enterState(MQTT_STATE_CONNECTED);
+                break;
+            }
+            if (connecting && elapsed < pdMS_TO_TICKS(MQTT_CONNECT_TIMEOUT_MS))
+                return pdMS_TO_TICKS(MQTT_CONNECT_TIMEOUT_MS) - elapsed;
+            if (connecting) {
+                cyw43_arch_lwip_begin();
+                mqtt_disconnect(client);
+                cyw43_arch_lwip_end();
+                connecting = false;
+            }
+#ifdef MQTT_CERT_INC
+            cyw43_arch_lwip_begin();
+            tls.failed();
+            cyw43_arch_lwip_end();
+#endif
+            // Falhas seguidas: o broker pode ter mudado de endereco
+            if (++brokerFailures >= MQTT_DNS_REFRESH_FAILURES) {
+                brokerFailures = 0;
+                brokerResolved = false;
+            }
+            backoff("[MQTT] Broker nao respondeu");
+            break;
+
+        case MQTT_STATE_CONNECTED:
+            if (connected) return portMAX_DELAY;
+            // Queda da sessao com o link ainda de pe
+            outageStart = now;
+            backoffMs = MQTT_BACKOFF_MIN_MS;
+            backoff("[MQTT] Conexao com o broker perdida");
+            break;
+        }
     }
 }
 
 bool MqttClient::publish(const char* topic, const char* payload) {
-    MqttMessage msg;
-    strncpy(msg.topic, topic, sizeof(msg.topic) - 1);
-    strncpy(msg.payload, payload, sizeof(msg.payload) - 1);
-    
-    // Envia para a fila (thread-safe). Não bloqueia se a fila estiver cheia (0 delay)
-    // para não travar a task de envio.
-    if (xQueueSend(msgQueue, &msg, 0) == pdTRUE) {
-        return true;
-    } else {
+    return publish(topic, payload, strlen(payload));
+}
+
+bool MqttClient::publish(const char* topic, const void* payload, uint16_t length) {
+    uint8_t* slot = reserve(topicId(topic), length);
+    if (slot == NULL) return false;
+    memcpy(slot, payload, length);
+    commit(slot);
+    return true;
+}
+
+uint8_t MqttClient::topicId(const char* topic) {
+    uint8_t id = MQTT_TOPIC_INVALID;
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < topicCount; i++) {
+        if (strcmp(topics[i], topic) == 0) {
+            id = i;
+            break;
+        }
+    }
+    if (id == MQTT_TOPIC_INVALID && topicCount < MQTT_MAX_TOPICS) {
+        topics[topicCount] = topic;
+        id = topicCount++;
+    }
+    taskEXIT_CRITICAL();
+    if (id == MQTT_TOPIC_INVALID) printf("[MQTT] Limite de topicos atingido: %s\n", topic);
+    return id;
+}
+
+uint8_t* MqttClient::reserve(uint8_t topic, uint16_t length) {
+    if (topic >= topicCount) return NULL;
+    if (length > MQTT_MAX_PAYLOAD) {
+        printf("[MQTT] Payload muito grande (%u bytes)\n", length);
+        taskENTER_CRITICAL();
+        stats.drops++;
+        taskEXIT_CRITICAL();
+        return NULL;
+    }
+    // Não bloqueia se a fila estiver cheia, para não travar a task de envio
+    uint8_t* slot = outbox.reserve(topic, length);
+    if (slot == NULL) {
         printf("[MQTT] Fila cheia! Mensagem descartada.\n");
-        return false;
+        taskENTER_CRITICAL();
+        stats.drops++;
+        taskEXIT_CRITICAL();
+    }
+    return slot;
+}
+
+void MqttClient::commit(uint8_t* payload) {
+    outbox.commit(payload);
+    notify(MQTT_EVENT_PUBLISH);
+}
+
+void MqttClient::releaseCompleted() {
+    uint32_t errors = failed; // failed cresce antes de completed no callback
+    uint32_t done = completed;
+    while (completedSeen != done) {
+        outbox.release();
+        completedSeen++;
     }
+    taskENTER_CRITICAL();
+    stats.published = done - errors;
+    stats.drops += errors - failedSeen;
+    taskEXIT_CRITICAL();
+    failedSeen = errors;
 }
 
-void MqttClient::processQueue() {
-    if (!connected) return;
+bool MqttClient::processQueue() {
+    if (!connected) return false;
 
-    MqttMessage msg;
-    // Verifica se há algo na fila
-    while (xQueueReceive(msgQueue, &msg, 0) == pdTRUE) {
-        err_t err = mqtt_publish(client, msg.topic, msg.payload, strlen(msg.payload), 0, 0, mqttPubRequestCb, this);
+#ifdef MQTT_FLASH_OUTBOX
+    // As mensagens da flash sao as mais antigas: a fila da RAM so volta a
+    // enviar direto quando a flash esvaziar (ate la ela e despejada na flash)
+    if (flashOutbox.pending() > 0) return replayFlash();
+#endif
+
+    uint8_t topic;
+    const uint8_t* payload;
+    uint16_t length;
+    // O lwIP copia o payload para o seu buffer de saida; a mensagem continua na
+    // fila (em voo) ate o mqttPubRequestCb confirmar o envio
+    while (outbox.peek(&topic, &payload, &length)) {
+        // Janela: no maximo MQTT_REQ_MAX_IN_FLIGHT publicacoes entregues ao lwIP
+        if (outbox.inFlight() >= MQTT_REQ_MAX_IN_FLIGHT) {
+            stats.stalls++;
+            return false; // O MQTT_EVENT_SENT rearma
+        }
+        cyw43_arch_lwip_begin();
+        err_t err = mqtt_publish(client, topics[topic], payload, length, 0, 0, mqttPubRequestCb, this);
+        cyw43_arch_lwip_end();
         if (err != ERR_OK) {
-            printf("[MQTT] Erro ao enviar para lwIP: %d\n", err);
-            // Opcional: Colocar de volta na fila se for crítico
+            // Buffer TCP cheio (ERR_MEM) ou conexao caindo: a mensagem fica na
+            // cabeca da fila. Com publicacoes em voo o MQTT_EVENT_SENT rearma,
+            // sem elas so o timeout da task
+            stats.retries++;
+            return outbox.inFlight() == 0;
+        }
+        outbox.advance();
+    }
+    return false;
+}
+
+MqttStats MqttClient::getStats() {
+    MqttStats copy;
+    taskENTER_CRITICAL();
+    copy = stats;
+    taskEXIT_CRITICAL();
+#ifdef MQTT_FLASH_OUTBOX
+    copy.drops += flashOutbox.lost();
+#endif
+#ifdef MQTT_CERT_INC
+    copy.tls = tls.getStats();
+#endif
+    return copy;
+}
+
+#ifdef MQTT_FLASH_OUTBOX
+void MqttClient::mqttReplayCb(void *arg, err_t result) {
+    MqttReplaySlot* slot = (MqttReplaySlot*)arg;
+    // A gravacao na flash fica com a task: aqui so marca o resultado
+    slot->state = (result == ERR_OK) ? MQTT_REPLAY_ACKED : MQTT_REPLAY_FAILED;
+    slot->self->notify(MQTT_EVENT_SENT);
+}
+
+// Custo: cada gravacao na flash (flash_safe_execute) desliga as interrupcoes e
+// para o outro nucleo, entao os instantes das portas (gpio_irq_handler) atrasam
+// ate ~0,5 ms por pagina, ou ~45 ms quando um setor e apagado (1 a cada 16
+// mensagens). As mensagens vao em lotes de FLASH_OUTBOX_BATCH paginas, um
+// bloqueio por lote e nao um por mensagem
+void MqttClient::spillToFlash() {
+    // So com a fila parada: nenhuma mensagem da RAM entregue ao lwIP
+    if (outbox.inFlight() > 0) return;
+
+    uint8_t topic;
+    const uint8_t* payload;
+    uint16_t length;
+    while (outbox.peek(&topic, &payload, &length)) {
+        if (flashOutbox.append(topics[topic], payload, length)) {
+            stats.stored++;
         } else {
-            printf("[MQTT] Publicado em %s: %s\n", msg.topic, msg.payload);
+            taskENTER_CRITICAL();
+            stats.drops++;
+            taskEXIT_CRITICAL();
+        }
+        outbox.advance();
+        outbox.release();
+    }
+    flashOutbox.flush();
+}
+
+void MqttClient::processReplayAcks() {
+    bool inFlight = false;
+    for (int i = 0; i < MQTT_REQ_MAX_IN_FLIGHT; i++) {
+        MqttReplaySlot* slot = &replaySlots[i];
+        if (slot->state == MQTT_REPLAY_ACKED) {
+            if (flashOutbox.ack(slot->page, slot->sequence)) stats.replayed++;
+            slot->state = MQTT_REPLAY_FREE;
+        } else if (slot->state == MQTT_REPLAY_FAILED) {
+            slot->state = MQTT_REPLAY_FREE;
+            replayRewind = true;
+        } else if (slot->state == MQTT_REPLAY_IN_FLIGHT) {
+            inFlight = true;
         }
     }
+    flashOutbox.flush(); // Confirmacoes gravadas em um lote
+    if (replayRewind && !inFlight) {
+        replayPage = flashOutbox.oldest();
+        replayRewind = false;
+    }
 }
 
-// Task para manter o MQTT Client
+void MqttClient::resetReplay() {
+    // Conexao fechada: o lwIP descartou os envios sem callback
+    for (int i = 0; i < MQTT_REQ_MAX_IN_FLIGHT; i++)
+        replaySlots[i].state = MQTT_REPLAY_FREE;
+    replayPage = flashOutbox.oldest();
+    replayRewind = false;
+}
+
+bool MqttClient::replayFlash() {
+    const char* topic;
+    const uint8_t* payload;
+    uint16_t length;
+    uint32_t sequence;
+
+    while (replayPage != flashOutbox.end()) {
+        if (!flashOutbox.read(replayPage, &topic, &payload, &length, &sequence)) {
+            replayPage = FlashOutbox::next(replayPage); // Ja confirmada
+            continue;
+        }
+
+        MqttReplaySlot* slot = NULL;
+        bool inFlight = false;
+        for (int i = 0; i < MQTT_REQ_MAX_IN_FLIGHT; i++) {
+            if (replaySlots[i].state == MQTT_REPLAY_FREE) {
+                if (slot == NULL) slot = &replaySlots[i];
+            } else {
+                inFlight = true;
+            }
+        }
+        if (slot == NULL) {
+            stats.stalls++;
+            return false; // O PUBACK rearma
+        }
+
+        slot->page = replayPage;
+        slot->sequence = sequence;
+        slot->state = MQTT_REPLAY_IN_FLIGHT;
+        cyw43_arch_lwip_begin();
+        err_t err = mqtt_publish(client, topic, payload, length, 1, 0, mqttReplayCb, slot);
+        cyw43_arch_lwip_end();
+        if (err != ERR_OK) {
+            slot->state = MQTT_REPLAY_FREE;
+            stats.retries++;
+            return !inFlight;
+        }
+        replayPage = FlashOutbox::next(replayPage);
+    }
+    return false;
+}
+#endif
+
+// Task para manter o MQTT Client: dorme ate um evento (publicacao, callback do
+// lwIP, link ou DNS) ou ate o proximo prazo da maquina de estados da conexao
 void MqttClient::taskImpl(void* _this) {
     MqttClient* self = (MqttClient*)_this; // Cast para a instância
-    
+    self->task = xTaskGetCurrentTaskHandle();
+    TickType_t wait = 0;
+
     // Loop principal da Task
     while (true) {
-        self->connectWifi();
-        
-        if (self->wifiConnected) {
-            if (!self->connected) {
-                self->connectBroker();
-            } else {
-                self->processQueue();
+        xTaskNotifyWait(0, 0xFFFFFFFF, NULL, wait);
+
+        self->releaseCompleted();
+
+        if (!self->connected) {
+            // O lwIP descarta as publicacoes pendentes ao fechar a conexao, sem
+            // callback: as que estavam em voo voltam para o envio
+            uint32_t requeued = self->outbox.rewind();
+            if (requeued) {
+                taskENTER_CRITICAL();
+                self->stats.requeued += requeued;
+                taskEXIT_CRITICAL();
+                self->completedSeen = self->completed;
+                self->failedSeen = self->failed;
             }
         }
-        
-        // Mantém a task rodando
-        vTaskDelay(pdMS_TO_TICKS(100)); // Verifica a cada 100ms
+
+#ifdef MQTT_FLASH_OUTBOX
+        self->processReplayAcks();
+        if (!self->connected) self->resetReplay();
+        // Sem broker, ou com mensagens antigas ainda na flash, as novas vao para o fim do log
+        if (self->flashOutboxReady && (!self->connected || self->flashOutbox.pending() > 0)) self->spillToFlash();
+#endif
+
+        wait = self->runConnection();
+        if (self->state != MQTT_STATE_CONNECTED) continue;
+
+        // Se o lwIP recusou por falta de buffer, o MQTT_EVENT_SENT acorda a
+        // task; o timeout cobre o caso de nenhuma publicacao estar em voo
+        if (self->processQueue() && wait > pdMS_TO_TICKS(MQTT_RETRY_MS)) wait = pdMS_TO_TICKS(MQTT_RETRY_MS);
     }
-}
\ No newline at end of file
+}
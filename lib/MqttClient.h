@@ -6,18 +6,87 @@
 #include "FreeRTOS.h"
 #include "queue.h"
 #include "task.h"
+#include "MqttOutbox.h"
+#ifdef MQTT_FLASH_OUTBOX
+#include "FlashOutbox.h"
+#endif
+#ifdef MQTT_CERT_INC
+#include "MqttTls.h"
+#endif
 
 // Configurações do MQTT
 #define WIFI_SSID "Jr telecom _ Taylan"
 #define WIFI_PASS "Suta3021"
-#define MQTT_BROKER_IP "192.168.18.165" // IP do seu Broker
+#define MQTT_BROKER_HOST "192.168.18.165" // IP ou nome do seu Broker (resolvido por DNS)
+#ifdef MQTT_CERT_INC
+#define BROKER_PORT 8883 // MQTT sobre TLS
+#else
 #define BROKER_PORT 1883
-#define MQTT_MSG_QUEUE_SIZE 120 // Quantas mensagens guardar se estiver offline
+#endif
+#define MQTT_MAX_PAYLOAD 128 // Maior payload aceito (cabe no ring de saida do lwIP)
+#define MQTT_MAX_TOPICS 8     // Topicos distintos guardados na fila de saida
+#define MQTT_TOPIC_INVALID 0xFF
+#define MQTT_RETRY_MS 2000    // Nova tentativa de envio quando o lwIP recusou sem nada em voo
 
-// Estrutura para mensagens na fila
-struct MqttMessage {
-    char topic[100];
-    char payload[128];
+// Reconexao: espera exponencial com jitter entre tentativas que falharam
+#define MQTT_BACKOFF_MIN_MS 500
+#define MQTT_BACKOFF_MAX_MS (60 * 1000)
+#define MQTT_WIFI_JOIN_TIMEOUT_MS 15000 // Associacao + DHCP
+#define MQTT_WIFI_POLL_MS 250           // Consulta do estado da associacao (o cyw43 nao avisa falhas)
+#define MQTT_DNS_TIMEOUT_MS 10000
+#define MQTT_CONNECT_TIMEOUT_MS 10000   // CONNACK do broker
+#define MQTT_DNS_REFRESH_FAILURES 3     // Falhas seguidas no broker antes de resolver o nome de novo
+
+// Estados da conexao
+enum MqttConnState {
+    MQTT_STATE_BACKOFF,      // Esperando a proxima tentativa
+    MQTT_STATE_WIFI_JOIN,    // Iniciar a associacao ao AP
+    MQTT_STATE_WIFI_WAIT,    // Associacao e DHCP em andamento
+    MQTT_STATE_DNS,          // Resolver o endereco do broker (ou usar o cache)
+    MQTT_STATE_DNS_WAIT,
+    MQTT_STATE_BROKER,       // Abrir a conexao MQTT
+    MQTT_STATE_BROKER_WAIT,  // Aguardando o CONNACK
+    MQTT_STATE_CONNECTED
+};
+
+// Eventos que acordam a task do MQTT (bits da notificacao de indice 0)
+#define MQTT_EVENT_PUBLISH    (1u << 0) // Mensagem confirmada na fila
+#define MQTT_EVENT_CONNECTION (1u << 1) // Resultado da conexao com o broker / desconexao
+#define MQTT_EVENT_SENT       (1u << 2) // lwIP liberou espaco no buffer de saida
+#define MQTT_EVENT_LINK       (1u << 3) // Link Wi-Fi subiu ou caiu
+#define MQTT_EVENT_DNS        (1u << 4) // Resolucao do broker concluida
+
+// Contadores da publicacao (getStats)
+struct MqttStats {
+    uint32_t published; // Mensagens confirmadas pelo lwIP
+    uint32_t retries;   // Recusas do lwIP (ERR_MEM): a mensagem fica na fila e e tentada de novo
+    uint32_t drops;     // Mensagens perdidas (fila cheia, payload grande, erro do lwIP)
+    uint32_t stalls;    // Vezes que a janela de envio encheu com mensagens esperando
+    uint32_t requeued;  // Mensagens em voo na queda da conexao, enviadas de novo
+    uint32_t stored;    // Mensagens gravadas na fila duravel (flash)
+    uint32_t replayed;  // Mensagens da flash confirmadas pelo broker (PUBACK)
+    uint32_t reconnects;      // Conexoes ao broker bem sucedidas
+    uint32_t connectFailures; // Tentativas (Wi-Fi, DNS ou broker) que falharam
+    uint32_t lastOutageMs;    // Duracao da ultima queda, ate o CONNACK
+    uint32_t lastConnectMs;   // Duracao da ultima tentativa bem sucedida (Wi-Fi ate o CONNACK)
+#ifdef MQTT_CERT_INC
+    MqttTlsStats tls;
+#endif
+};
+
+class MqttClient;
+
+// Estados de uma mensagem da flash enviada com QoS 1
+#define MQTT_REPLAY_FREE      0
+#define MQTT_REPLAY_IN_FLIGHT 1 // Aguardando o PUBACK
+#define MQTT_REPLAY_ACKED     2 // PUBACK recebido: a task marca na flash
+#define MQTT_REPLAY_FAILED    3 // Timeout do lwIP: reenviar
+
+struct MqttReplaySlot {
+    MqttClient* self;
+    uint32_t page;      // Pagina da mensagem no FlashOutbox
+    uint32_t sequence;
+    volatile uint8_t state;
 };
 
 class MqttClient {
@@ -28,8 +97,17 @@ public:
     // Inicializa hardware Wi-Fi e estruturas
     bool begin();
 
-    // Método para publicar mensagens (Thread-safe, usa fila)
+    // Método para publicar mensagens (Thread-safe, copia o payload para a fila)
     bool publish(const char* topic, const char* payload);
+    bool publish(const char* topic, const void* payload, uint16_t length);
+
+    // Publicacao sem copia extra: reserva o payload na fila, escreve no lugar e confirma.
+    // O topico precisa continuar valido (literal): a fila guarda so o indice.
+    uint8_t topicId(const char* topic);
+    uint8_t* reserve(uint8_t topic, uint16_t length); // NULL se a fila esta cheia
+    void commit(uint8_t* payload);
+
+    MqttStats getStats();
 
     // Função estática que será a Task do FreeRTOS
     static void taskImpl(void* _this);
@@ -37,24 +115,73 @@ public:
 private:
     mqtt_client_t* client;
     struct mqtt_connect_client_info_t clientInfo;
-    QueueHandle_t msgQueue;
-    bool connected;
-    bool wifiConnected;
+    MqttOutbox outbox;
+    const char* topics[MQTT_MAX_TOPICS];
+    uint8_t topicCount;
+    TaskHandle_t task;
+    volatile bool connected;
+    volatile bool connecting;    // mqtt_client_connect em andamento
+    volatile bool linkLost;      // netifLinkCb viu o link cair
+    volatile int8_t dnsResult;   // 0 pendente, 1 resolvido, -1 falhou
+    MqttConnState state;
+    TickType_t stateSince;       // Entrada no estado atual (timeouts)
+    TickType_t retryAt;          // Fim do backoff
+    uint32_t backoffMs;          // Proxima espera base
+    TickType_t attemptStart;     // Inicio da tentativa atual
+    TickType_t outageStart;      // Queda da conexao (0 antes da primeira)
+    ip_addr_t brokerAddr;        // Cache da resolucao do broker
+    bool brokerResolved;
+    uint8_t brokerFailures;      // Falhas seguidas no broker com o endereco do cache
+    bool wifiStarted;            // Primeira associacao concluida (SNTP, callbacks)
+    volatile uint32_t completed; // Publicacoes concluidas pelo lwIP (mqttPubRequestCb)
+    volatile uint32_t failed;    // Das concluidas, quantas com erro
+    uint32_t completedSeen;      // completed ja processado pela task
+    uint32_t failedSeen;
+    MqttStats stats;
+
+    // Libera da fila as mensagens que o lwIP terminou de enviar
+    void releaseCompleted();
+
+#ifdef MQTT_FLASH_OUTBOX
+    // Fila duravel: recebe as mensagens enquanto o broker esta fora (ou
+    // enquanto ainda ha mensagens antigas nela) e as reenvia com QoS 1
+    FlashOutbox flashOutbox;
+    MqttReplaySlot replaySlots[MQTT_REQ_MAX_IN_FLIGHT];
+    uint32_t replayPage; // Proxima pagina da flash a enviar
+    bool replayRewind;   // Um envio falhou: recomeca do inicio quando a janela esvaziar
+    bool flashOutboxReady; // Regiao da flash conferida no begin
+
+    void spillToFlash();
+    bool replayFlash();
+    void processReplayAcks();
+    void resetReplay();
+    static void mqttReplayCb(void *arg, err_t result);
+#endif
+
+#ifdef MQTT_CERT_INC
+    MqttTls tls; // Configuracao e cache da sessao TLS
+#endif
+
+    // Acorda a task do MQTT (task ou interrupcao)
+    void notify(uint32_t events);
 
-    // Conecta ao Wi-Fi
-    void connectWifi();
-    
-    // Conecta ao Broker MQTT
-    void connectBroker();
+    // Maquina de estados da conexao (Wi-Fi -> DNS -> broker). Nunca bloqueia:
+    // retorna quanto a task pode dormir ate precisar rodar de novo
+    TickType_t runConnection();
+    void enterState(MqttConnState next);
+    void backoff(const char* reason);
 
-    // Processa a fila de mensagens pendentes
-    void processQueue();
+    // Processa a fila de mensagens pendentes; true se ficou mensagem para tras
+    bool processQueue();
 
     // --- Callbacks estáticos necessários para o lwIP (C API) ---
     static void mqttConnectionCb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status);
     static void mqttPubRequestCb(void *arg, err_t result);
     static void mqttIncomingPublishCb(void *arg, const char *topic, u32_t tot_len);
     static void mqttIncomingDataCb(void *arg, const u8_t *data, u16_t len, u8_t flags);
+    static void netifLinkCb(struct netif *netif);
+    static void netifStatusCb(struct netif *netif);
+    static void dnsFoundCb(const char *name, const ip_addr_t *ipaddr, void *arg);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "MqttOutbox.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define OUTBOX_RESERVED 1 // Produtor ainda escrevendo
+#define OUTBOX_READY 2    // Pronta para envio
+#define OUTBOX_WRAP 3     // Fim do ring sem uso: a proxima mensagem esta no inicio
+
+typedef struct{
+    uint16_t length; // Bytes do payload
+    uint8_t topic;   // Indice do topico no MqttClient
+    volatile uint8_t state;
+} outbox_header_t;
+
+// Espaco total de uma mensagem: cabecalho + payload arredondado para 4 bytes
+static inline uint32_t entry_size(uint16_t length){
+    return sizeof(outbox_header_t) + ((length + 3u) & ~3u);
+}
+
+MqttOutbox::MqttOutbox(){
+    _head = 0;
+    _tail = 0;
+    _send = 0;
+    _sending = 0;
+    _used = 0;
+    _count = 0;
+}
+
+uint8_t *MqttOutbox::reserve(uint8_t topic, uint16_t length){
+    uint32_t need = entry_size(length);
+    uint8_t *base = (uint8_t *)_buffer;
+    outbox_header_t *header = NULL;
+
+    // Secao critica curta: so ajusta os indices, o payload e escrito fora dela
+    taskENTER_CRITICAL();
+    uint32_t to_end = MQTT_OUTBOX_SIZE - _head;
+    if(need <= to_end && need <= MQTT_OUTBOX_SIZE - _used){
+        header = (outbox_header_t *)(base + _head);
+    } else if(need > to_end && to_end + need <= MQTT_OUTBOX_SIZE - _used){
+        // Nao cabe no fim: marca o resto como pulado e reserva no inicio
+        ((outbox_header_t *)(base + _head))->state = OUTBOX_WRAP;
+        _used += to_end;
+        _head = 0;
+        header = (outbox_header_t *)base;
+    }
+    if(header != NULL){
+        header->length = length;
+        header->topic = topic;
+        header->state = OUTBOX_RESERVED;
+        _head += need;
+        if(_head == MQTT_OUTBOX_SIZE) _head = 0;
+        _used += need;
+        _count++;
+    }
+    taskEXIT_CRITICAL();
+
+    return header ? (uint8_t *)(header + 1) : NULL;
+}
+
+void MqttOutbox::commit(uint8_t *payload){
+    outbox_header_t *header = (outbox_header_t *)payload - 1;
+    __sync_synchronize(); // Payload visivel antes do estado
+    header->state = OUTBOX_READY;
+}
+
+bool MqttOutbox::peek(uint8_t *topic, const uint8_t **payload, uint16_t *length){
+    uint8_t *base = (uint8_t *)_buffer;
+    bool ready = false;
+
+    taskENTER_CRITICAL();
+    while(_sending < _count){
+        outbox_header_t *header = (outbox_header_t *)(base + _send);
+        if(header->state == OUTBOX_WRAP){
+            _send = 0;
+            continue;
+        }
+        if(header->state == OUTBOX_READY){
+            *topic = header->topic;
+            *payload = (const uint8_t *)(header + 1);
+            *length = header->length;
+            ready = true;
+        }
+        break;
+    }
+    taskEXIT_CRITICAL();
+    __sync_synchronize();
+    return ready;
+}
+
+void MqttOutbox::advance(){
+    outbox_header_t *header = (outbox_header_t *)((uint8_t *)_buffer + _send);
+
+    taskENTER_CRITICAL();
+    _send += entry_size(header->length);
+    if(_send == MQTT_OUTBOX_SIZE) _send = 0;
+    _sending++;
+    taskEXIT_CRITICAL();
+}
+
+void MqttOutbox::release(){
+    uint8_t *base = (uint8_t *)_buffer;
+
+    taskENTER_CRITICAL();
+    if(_sending > 0){
+        outbox_header_t *header = (outbox_header_t *)(base + _tail);
+        if(header->state == OUTBOX_WRAP){
+            _used -= MQTT_OUTBOX_SIZE - _tail;
+            _tail = 0;
+            header = (outbox_header_t *)base;
+        }
+        uint32_t size = entry_size(header->length);
+        _tail += size;
+        if(_tail == MQTT_OUTBOX_SIZE) _tail = 0;
+        _used -= size;
+        _count--;
+        _sending--;
+        // Ring vazio: volta ao inicio para ter o maior espaco contiguo possivel
+        if(_count == 0){
+            _head = 0;
+            _tail = 0;
+            _send = 0;
+            _used = 0;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+uint32_t MqttOutbox::rewind(){
+    taskENTER_CRITICAL();
+    uint32_t pending = _sending;
+    _send = _tail;
+    _sending = 0;
+    taskEXIT_CRITICAL();
+    return pending;
+}
+
+uint32_t MqttOutbox::count(){
+    return _count;
+}
+
+uint32_t MqttOutbox::inFlight(){
+    return _sending;
+}
+
+uint32_t MqttOutbox::freeBytes(){
+    return MQTT_OUTBOX_SIZE - _used;
+}
@@ -0,0 +1,46 @@
+#ifndef MQTTOUTBOX_H
+#define MQTTOUTBOX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MQTT_OUTBOX_SIZE (16 * 1024) // Bytes do ring (cabecalhos + payloads)
+
+// Fila de saida do MQTT em um ring de bytes: cada mensagem ocupa so o seu
+// tamanho (cabecalho de 4 bytes + payload alinhado a 4), com o topico
+// guardado como um indice. O produtor reserva o espaco, escreve o payload no
+// lugar e confirma; o consumidor entrega o payload direto ao mqtt_publish.
+// As mensagens saem na ordem da reserva: uma reserva ainda nao confirmada
+// segura as seguintes. Uma mensagem entregue continua no ring ("em voo") ate
+// o lwIP confirmar o envio (release); se a conexao cair, rewind volta o
+// cursor de envio para a mais antiga e elas sao enviadas de novo.
+class MqttOutbox{
+    private:
+        uint32_t _buffer[MQTT_OUTBOX_SIZE / sizeof(uint32_t)];
+        uint32_t _head;  // Proxima reserva (offset em bytes)
+        uint32_t _tail;  // Mensagem mais antiga
+        uint32_t _send;  // Proxima mensagem a entregar ao lwIP
+        uint32_t _sending; // Mensagens entregues e ainda nao liberadas
+        uint32_t _used;  // Bytes ocupados, incluindo o fim pulado em uma volta
+        uint32_t _count; // Mensagens no ring
+
+    public:
+        // Construtor
+        MqttOutbox();
+
+        // Produtores (thread-safe)
+        uint8_t *reserve(uint8_t topic, uint16_t length); // NULL se nao ha espaco
+        void commit(uint8_t *payload);                    // Libera para envio
+
+        // Consumidor (somente a task do MQTT)
+        bool peek(uint8_t *topic, const uint8_t **payload, uint16_t *length); // Proxima mensagem pronta para envio
+        void advance();  // A mensagem devolvida por peek foi entregue ao lwIP
+        void release();  // Envio da mensagem em voo mais antiga confirmado: libera o espaco
+        uint32_t rewind(); // Reenvia as mensagens em voo; retorna quantas eram
+
+        uint32_t count();
+        uint32_t inFlight();
+        uint32_t freeBytes();
+};
+
+#endif
@@ -0,0 +1,180 @@
+// lib/MqttTls.cpp
+#include "MqttTls.h"
+
+#ifdef MQTT_CERT_INC
+
+#include "lwip/apps/mqtt_priv.h"
+#include "mbedtls/platform.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// Define TLS_ROOT_CERT: a CA do broker em PEM
+#include MQTT_CERT_INC
+
+static const uint8_t caCert[] = TLS_ROOT_CERT;
+
+// Contabilidade do alocador. So o lwIP (IRQ de background do cyw43 ou task com
+// o lock) chama o mbedTLS, entao nao ha duas alocacoes ao mesmo tempo
+static uint32_t heapInUse = 0;
+static uint32_t heapPeak = 0;
+static uint32_t heapRefused = 0;
+static uint32_t handshakePeak = 0;
+
+// Cabecalho de 8 bytes: guarda o tamanho e mantem o alinhamento do bloco
+#define TLS_HEAP_HEADER 8
+
+void* MqttTls::tlsCalloc(size_t count, size_t size) {
+    if (size != 0 && count > (SIZE_MAX - TLS_HEAP_HEADER) / size) return NULL;
+    size_t bytes = count * size;
+    if (heapInUse + bytes + TLS_HEAP_HEADER > MQTT_TLS_HEAP_LIMIT) {
+        heapRefused++;
+        return NULL; // O mbedTLS devolve MBEDTLS_ERR_*_ALLOC_FAILED e o handshake falha
+    }
+    uint8_t* block = (uint8_t*)calloc(1, bytes + TLS_HEAP_HEADER);
+    if (block == NULL) {
+        heapRefused++;
+        return NULL;
+    }
+    *(uint32_t*)block = bytes + TLS_HEAP_HEADER;
+    heapInUse += bytes + TLS_HEAP_HEADER;
+    if (heapInUse > heapPeak) heapPeak = heapInUse;
+    if (heapInUse > handshakePeak) handshakePeak = heapInUse;
+    return block + TLS_HEAP_HEADER;
+}
+
+void MqttTls::tlsFree(void* ptr) {
+    if (ptr == NULL) return;
+    uint8_t* block = (uint8_t*)ptr - TLS_HEAP_HEADER;
+    heapInUse -= *(uint32_t*)block;
+    free(block);
+}
+
+MqttTls::MqttTls() {
+    tlsConfig = NULL;
+    mbedtls_ssl_session_init(&session);
+    sessionValid = false;
+    resumeOffered = false;
+    certificateSeen = false;
+    fullHandshakes = 0;
+    resumedHandshakes = 0;
+    lastFullMs = 0;
+    lastResumedMs = 0;
+    lastFullPeak = 0;
+    lastResumedPeak = 0;
+}
+
+bool MqttTls::begin() {
+    // Antes da configuracao: tudo que o mbedTLS alocar passa pelo alocador
+    // contabilizado (o altcp nao instala o dele, ALTCP_MBEDTLS_PLATFORM_ALLOC 0)
+    mbedtls_platform_set_calloc_free(tlsCalloc, tlsFree);
+
+    tlsConfig = altcp_tls_create_config_client(caCert, sizeof(caCert));
+    if (tlsConfig == NULL) {
+        printf("[TLS] Falha ao criar a configuracao (CA invalida?)\n");
+        return false;
+    }
+    printf("[TLS] Configuracao criada, %lu bytes do mbedTLS em uso\n", (unsigned long)heapInUse);
+    return true;
+}
+
+mbedtls_ssl_context* MqttTls::context(mqtt_client_t* client) {
+    if (client == NULL || client->conn == NULL) return NULL;
+    return (mbedtls_ssl_context*)altcp_tls_context(client->conn);
+}
+
+void MqttTls::dropSession() {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    sessionValid = false;
+}
+
+// Chamado para cada certificado da cadeia que o broker mandou: so acontece no
+// handshake completo. Nao muda o resultado da verificacao (flags)
+int MqttTls::verifyCb(void* arg, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+    ((MqttTls*)arg)->certificateSeen = true;
+    return 0;
+}
+
+void MqttTls::connecting(mqtt_client_t* client, const char* hostname) {
+    mbedtls_ssl_context* ssl = context(client);
+    resumeOffered = false;
+    certificateSeen = false;
+    handshakePeak = heapInUse;
+    if (ssl == NULL) return;
+
+    // SNI e verificacao do nome no certificado
+    mbedtls_ssl_set_hostname(ssl, hostname);
+    mbedtls_ssl_set_verify(ssl, verifyCb, this);
+
+    // O handshake so comeca quando o TCP conectar: ainda da tempo de oferecer a sessao
+    if (sessionValid) {
+        if (mbedtls_ssl_set_session(ssl, &session) == 0) {
+            resumeOffered = true;
+        } else {
+            dropSession();
+        }
+    }
+}
+
+void MqttTls::connected(mqtt_client_t* client, uint32_t elapsedMs) {
+    mbedtls_ssl_context* ssl = context(client);
+    if (ssl == NULL) return;
+
+    mbedtls_ssl_session fresh;
+    mbedtls_ssl_session_init(&fresh);
+    if (mbedtls_ssl_get_session(ssl, &fresh) != 0) {
+        mbedtls_ssl_session_free(&fresh);
+        dropSession();
+        return;
+    }
+
+    // Na retomada o broker nao manda a mensagem Certificate. O session id nao
+    // serve: com session ticket o broker pode responder com um id qualquer
+    // (ou o mesmo que o cliente gerou) tanto na retomada quanto no completo
+    bool resumed = resumeOffered && !certificateSeen;
+
+    // Guarda a sessao nova: o ticket pode ter sido renovado pelo broker
+    mbedtls_ssl_session_free(&session);
+    session = fresh;
+    sessionValid = true;
+    resumeOffered = false;
+
+    taskENTER_CRITICAL();
+    if (resumed) {
+        resumedHandshakes++;
+        lastResumedMs = elapsedMs;
+        lastResumedPeak = handshakePeak;
+    } else {
+        fullHandshakes++;
+        lastFullMs = elapsedMs;
+        lastFullPeak = handshakePeak;
+    }
+    taskEXIT_CRITICAL();
+    printf("[TLS] Handshake %s em %lu ms, pico de %lu bytes\n", resumed ? "retomado" : "completo",
+           (unsigned long)elapsedMs, (unsigned long)handshakePeak);
+}
+
+void MqttTls::failed() {
+    // Uma sessao recusada nao deve travar as proximas tentativas
+    if (resumeOffered) dropSession();
+    resumeOffered = false;
+}
+
+MqttTlsStats MqttTls::getStats() {
+    MqttTlsStats copy;
+    taskENTER_CRITICAL();
+    copy.fullHandshakes = fullHandshakes;
+    copy.resumedHandshakes = resumedHandshakes;
+    copy.lastFullMs = lastFullMs;
+    copy.lastResumedMs = lastResumedMs;
+    copy.lastFullPeak = lastFullPeak;
+    copy.lastResumedPeak = lastResumedPeak;
+    copy.heapInUse = heapInUse;
+    copy.heapPeak = heapPeak;
+    copy.heapRefused = heapRefused;
+    taskEXIT_CRITICAL();
+    return copy;
+}
+
+#endif // MQTT_CERT_INC
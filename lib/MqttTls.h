@@ -0,0 +1,76 @@
+#ifndef MQTTTLS_H
+#define MQTTTLS_H
+
+#ifdef MQTT_CERT_INC
+
+#include "lwip/apps/mqtt.h"
+#include "lwip/altcp_tls.h"
+#include "mbedtls/ssl.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Teto da memoria do mbedTLS. O heap_4 do FreeRTOS e estatico (configTOTAL_HEAP_SIZE),
+// entao o mbedTLS usa o heap da libc, que fica com o resto da RAM: sem o teto um
+// handshake podia esgotar esse resto e derrubar o lwIP e o printf
+#define MQTT_TLS_HEAP_LIMIT (48 * 1024)
+
+// Contadores do TLS (dentro do MqttStats)
+struct MqttTlsStats {
+    uint32_t fullHandshakes;    // Conexoes com handshake completo (ECDHE + certificado)
+    uint32_t resumedHandshakes; // Conexoes que retomaram a sessao do cache
+    uint32_t lastFullMs;        // Ultimo handshake completo: abertura ate o CONNACK
+    uint32_t lastResumedMs;     // Ultima retomada: abertura ate o CONNACK
+    uint32_t lastFullPeak;      // Pico de memoria do mbedTLS no ultimo handshake completo
+    uint32_t lastResumedPeak;   // Pico de memoria do mbedTLS na ultima retomada
+    uint32_t heapInUse;         // Memoria do mbedTLS agora (sessao aberta + cache)
+    uint32_t heapPeak;          // Maior uso desde o boot
+    uint32_t heapRefused;       // Alocacoes negadas pelo MQTT_TLS_HEAP_LIMIT
+};
+
+// TLS da conexao com o broker (altcp_tls + mbedTLS). Guarda a ultima sessao
+// negociada: na reconexao o cliente a oferece (session ticket ou session id) e,
+// se o broker aceitar, o handshake pula o ECDHE e a verificacao do certificado.
+// Todos os metodos, menos getStats, rodam com o lock do lwIP
+// (cyw43_arch_lwip_begin), como o mqtt_client_connect.
+class MqttTls {
+public:
+    MqttTls();
+
+    // Cria a configuracao do cliente com a CA do broker e instala o alocador
+    bool begin();
+    struct altcp_tls_config* config() { return tlsConfig; }
+
+    // Logo depois do mqtt_client_connect, antes do TCP conectar: SNI e sessao do cache
+    void connecting(mqtt_client_t* client, const char* hostname);
+    // CONNACK recebido: guarda a sessao e contabiliza o handshake
+    void connected(mqtt_client_t* client, uint32_t elapsedMs);
+    // Tentativa falhou: se ofereceu a sessao do cache, ela e descartada
+    void failed();
+
+    MqttTlsStats getStats();
+
+private:
+    struct altcp_tls_config* tlsConfig;
+    mbedtls_ssl_session session;
+    bool sessionValid;
+    bool resumeOffered;
+    bool certificateSeen; // O broker mandou o certificado: handshake completo
+    uint32_t fullHandshakes;
+    uint32_t resumedHandshakes;
+    uint32_t lastFullMs;
+    uint32_t lastResumedMs;
+    uint32_t lastFullPeak;
+    uint32_t lastResumedPeak;
+
+    static mbedtls_ssl_context* context(mqtt_client_t* client);
+    static int verifyCb(void* arg, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
+    void dropSession();
+
+    // Alocador do mbedTLS: libc com cabecalho de tamanho, contabilizado e limitado
+    static void* tlsCalloc(size_t count, size_t size);
+    static void tlsFree(void* ptr);
+};
+
+#endif // MQTT_CERT_INC
+
+#endif
@@ -0,0 +1,62 @@
+#include "ReportFilter.h"
+
+ReportFilter::ReportFilter(const report_policy_t &policy) : _policy(policy){
+    _sent = 0;
+    _skipped = 0;
+    reset();
+}
+
+void ReportFilter::reset(){
+    _last = 0;
+    _prev = 0;
+    _last_ms = 0;
+    _primed = false;
+}
+
+report_decision_t ReportFilter::check(int32_t value, uint32_t now_ms){
+    report_decision_t decision = REPORT_SKIP;
+
+    if(!_primed){
+        decision = REPORT_SEND;
+    } else {
+        // Diferenca em 64 bits: contadores com sinal nao estouram
+        int64_t diff = (int64_t)value - _last;
+        uint32_t delta = (uint32_t)(diff < 0 ? -diff : diff);
+        uint32_t magnitude = (uint32_t)(_last < 0 ? -(int64_t)_last : _last);
+        // Degrau desde a amostra anterior (enviada ou nao): evento, nao deriva
+        int64_t step_diff = (int64_t)value - _prev;
+        uint32_t step = (uint32_t)(step_diff < 0 ? -step_diff : step_diff);
+
+        // Limites em 0 estao desligados; sem nenhum dos dois, qualquer variacao e enviada
+        bool absolute = _policy.deadband && delta >= _policy.deadband;
+        bool relative = _policy.relative_pm && (uint64_t)delta * 1000 >= (uint64_t)magnitude * _policy.relative_pm;
+        bool any = !_policy.deadband && !_policy.relative_pm;
+
+        if(_policy.urgent_step && step >= _policy.urgent_step){
+            decision = REPORT_URGENT;
+        } else if(delta > 0 && (absolute || relative || any)){
+            decision = REPORT_SEND;
+        } else if(_policy.heartbeat_ms && now_ms - _last_ms >= _policy.heartbeat_ms){
+            decision = REPORT_SEND;
+        }
+    }
+
+    _prev = value;
+    if(decision == REPORT_SKIP){
+        _skipped++;
+    } else {
+        _last = value;
+        _last_ms = now_ms;
+        _primed = true;
+        _sent++;
+    }
+    return decision;
+}
+
+uint32_t ReportFilter::getSent(){
+    return _sent;
+}
+
+uint32_t ReportFilter::getSkipped(){
+    return _skipped;
+}
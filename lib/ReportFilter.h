@@ -0,0 +1,49 @@
+#ifndef REPORTFILTER_H
+#define REPORTFILTER_H
+
+#include <stdint.h>
+
+// Politica de envio de uma metrica (report by exception)
+typedef struct{
+    uint32_t deadband;     // Variacao absoluta minima para enviar, na unidade da metrica (0 = desligado)
+    uint16_t relative_pm;  // Ou variacao relativa ao ultimo valor enviado, em milesimos (0 = desligado)
+                           // Com os dois desligados qualquer variacao e enviada
+    uint32_t urgent_step;  // Degrau entre duas amostras seguidas que envia na hora, sem esperar o lote (0 = nunca)
+    uint32_t heartbeat_ms; // Silencio maximo: envia mesmo sem variacao (0 = nunca)
+} report_policy_t;
+
+typedef enum{
+    REPORT_SKIP = 0, // Dentro da banda morta e do heartbeat
+    REPORT_SEND,     // Vai para o lote
+    REPORT_URGENT    // Vai para o lote e o lote sai na hora
+} report_decision_t;
+
+// Decide se uma amostra precisa ser enviada. A comparacao e sempre com o
+// ultimo valor ENVIADO, nao com a amostra anterior: uma deriva lenta acumula
+// ate passar da banda morta. Ja o envio urgente olha o degrau entre duas
+// amostras seguidas, entao depende da cadencia de amostragem da metrica.
+// A primeira amostra sempre e enviada.
+// Os tempos sao contadores de 32 bits livres em ms (comparados pela diferenca).
+class ReportFilter{
+    private:
+        report_policy_t _policy;
+        int32_t _last;      // Ultimo valor enviado
+        int32_t _prev;      // Amostra anterior (degrau urgente)
+        uint32_t _last_ms;  // Instante do ultimo envio
+        bool _primed;       // Ja enviou alguma amostra
+        uint32_t _sent;
+        uint32_t _skipped;
+
+    public:
+        // Construtor
+        ReportFilter(const report_policy_t &policy);
+
+        // Metodos
+        report_decision_t check(int32_t value, uint32_t now_ms); // Se enviar, o valor vira a nova referencia
+        void reset(); // Proxima amostra e enviada
+        // Getters
+        uint32_t getSent();
+        uint32_t getSkipped();
+};
+
+#endif
@@ -30,6 +30,8 @@
  */
 
 #include "sensirion_gas_index_algorithm.h"
+
+#ifndef GAS_INDEX_ALGORITHM_FIXED_POINT
 #include <math.h>
 
 static void GasIndexAlgorithm__init_instances(GasIndexAlgorithmParams* params);
@@ -580,3 +582,5 @@ GasIndexAlgorithm__adaptive_lowpass__process(GasIndexAlgorithmParams* params,
         (((1.f - a3) * params->m_Adaptive_Lowpass___X3) + (a3 * sample));
     return params->m_Adaptive_Lowpass___X3;
 }
+
+#endif /* GAS_INDEX_ALGORITHM_FIXED_POINT */
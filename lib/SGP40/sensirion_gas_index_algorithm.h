@@ -115,51 +115,64 @@ extern "C" {
     (8.f)
 #define GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__FIX16_MAX (32767.f)
 
+/**
+ * Number type of the algorithm state. Define
+ * GAS_INDEX_ALGORITHM_FIXED_POINT to build the Q16.16 implementation
+ * (sensirion_gas_index_algorithm_fixed.c) instead of the float one, for cores
+ * without an FPU. The API is the same; only the state representation changes.
+ */
+#ifdef GAS_INDEX_ALGORITHM_FIXED_POINT
+typedef int32_t fix16_t;
+typedef fix16_t GasIndexAlgorithm_value_t;
+#else
+typedef float GasIndexAlgorithm_value_t;
+#endif
+
 /**
  * Struct to hold all parameters and states of the gas algorithm.
  */
 typedef struct {
     int mAlgorithm_Type;
-    float mSamplingInterval;
-    float mIndex_Offset;
+    GasIndexAlgorithm_value_t mSamplingInterval;
+    GasIndexAlgorithm_value_t mIndex_Offset;
     int32_t mSraw_Minimum;
-    float mGating_Max_Duration_Minutes;
-    float mInit_Duration_Mean;
-    float mInit_Duration_Variance;
-    float mGating_Threshold;
-    float mIndex_Gain;
-    float mTau_Mean_Hours;
-    float mTau_Variance_Hours;
-    float mSraw_Std_Initial;
-    float mUptime;
-    float mSraw;
-    float mGas_Index;
+    GasIndexAlgorithm_value_t mGating_Max_Duration_Minutes;
+    GasIndexAlgorithm_value_t mInit_Duration_Mean;
+    GasIndexAlgorithm_value_t mInit_Duration_Variance;
+    GasIndexAlgorithm_value_t mGating_Threshold;
+    GasIndexAlgorithm_value_t mIndex_Gain;
+    GasIndexAlgorithm_value_t mTau_Mean_Hours;
+    GasIndexAlgorithm_value_t mTau_Variance_Hours;
+    GasIndexAlgorithm_value_t mSraw_Std_Initial;
+    GasIndexAlgorithm_value_t mUptime;
+    GasIndexAlgorithm_value_t mSraw;
+    GasIndexAlgorithm_value_t mGas_Index;
     bool m_Mean_Variance_Estimator___Initialized;
-    float m_Mean_Variance_Estimator___Mean;
-    float m_Mean_Variance_Estimator___Sraw_Offset;
-    float m_Mean_Variance_Estimator___Std;
-    float m_Mean_Variance_Estimator___Gamma_Mean;
-    float m_Mean_Variance_Estimator___Gamma_Variance;
-    float m_Mean_Variance_Estimator___Gamma_Initial_Mean;
-    float m_Mean_Variance_Estimator___Gamma_Initial_Variance;
-    float m_Mean_Variance_Estimator__Gamma_Mean;
-    float m_Mean_Variance_Estimator__Gamma_Variance;
-    float m_Mean_Variance_Estimator___Uptime_Gamma;
-    float m_Mean_Variance_Estimator___Uptime_Gating;
-    float m_Mean_Variance_Estimator___Gating_Duration_Minutes;
-    float m_Mean_Variance_Estimator___Sigmoid__K;
-    float m_Mean_Variance_Estimator___Sigmoid__X0;
-    float m_Mox_Model__Sraw_Std;
-    float m_Mox_Model__Sraw_Mean;
-    float m_Sigmoid_Scaled__K;
-    float m_Sigmoid_Scaled__X0;
-    float m_Sigmoid_Scaled__Offset_Default;
-    float m_Adaptive_Lowpass__A1;
-    float m_Adaptive_Lowpass__A2;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Mean;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Sraw_Offset;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Std;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Gamma_Mean;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Gamma_Variance;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Gamma_Initial_Mean;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Gamma_Initial_Variance;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator__Gamma_Mean;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator__Gamma_Variance;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Uptime_Gamma;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Uptime_Gating;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Gating_Duration_Minutes;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Sigmoid__K;
+    GasIndexAlgorithm_value_t m_Mean_Variance_Estimator___Sigmoid__X0;
+    GasIndexAlgorithm_value_t m_Mox_Model__Sraw_Std;
+    GasIndexAlgorithm_value_t m_Mox_Model__Sraw_Mean;
+    GasIndexAlgorithm_value_t m_Sigmoid_Scaled__K;
+    GasIndexAlgorithm_value_t m_Sigmoid_Scaled__X0;
+    GasIndexAlgorithm_value_t m_Sigmoid_Scaled__Offset_Default;
+    GasIndexAlgorithm_value_t m_Adaptive_Lowpass__A1;
+    GasIndexAlgorithm_value_t m_Adaptive_Lowpass__A2;
     bool m_Adaptive_Lowpass___Initialized;
-    float m_Adaptive_Lowpass___X1;
-    float m_Adaptive_Lowpass___X2;
-    float m_Adaptive_Lowpass___X3;
+    GasIndexAlgorithm_value_t m_Adaptive_Lowpass___X1;
+    GasIndexAlgorithm_value_t m_Adaptive_Lowpass___X2;
+    GasIndexAlgorithm_value_t m_Adaptive_Lowpass___X3;
 } GasIndexAlgorithmParams;
 
 /**
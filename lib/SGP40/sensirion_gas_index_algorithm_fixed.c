@@ -0,0 +1,756 @@
+/*
+ * Copyright (c) 2022, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Q16.16 fixed-point port of sensirion_gas_index_algorithm.c, selected with
+ * GAS_INDEX_ALGORITHM_FIXED_POINT. The structure and the names follow the
+ * float implementation one to one. Only the per-sample path is integer:
+ * exp() comes from two small tables plus a short polynomial, the sigmoids
+ * use a single 32 bit division and sqrt() is an integer square root. The
+ * constants derived from the sampling interval and the tuning parameters are
+ * still computed in float, but only in init/reset/set_tuning_parameters.
+ * The std estimator keeps its variance in 64 bits with a Q0.32 gamma, Q16.16
+ * does not resolve its decay per sample.
+ */
+#include "sensirion_gas_index_algorithm.h"
+
+#ifdef GAS_INDEX_ALGORITHM_FIXED_POINT
+
+#define FIX16_ONE ((fix16_t)0x00010000)
+#define FIX16_MAXIMUM ((fix16_t)0x7FFFFFFF)
+#define FIX16_MINIMUM ((fix16_t)0x80000000)
+
+// Compile time conversion of the float constants
+#define F16(x) \
+    ((fix16_t)(((x) >= 0) ? ((x)*65536.0 + 0.5) : ((x)*65536.0 - 0.5)))
+
+static inline fix16_t fix16_from_int(int32_t a) {
+    return a * FIX16_ONE;
+}
+
+static inline fix16_t fix16_from_float(float a) {
+    float temp = a * 65536.f;
+    temp += (temp >= 0.f) ? 0.5f : -0.5f;
+    return (fix16_t)temp;
+}
+
+static inline float fix16_to_float(fix16_t a) {
+    return (float)a / 65536.f;
+}
+
+static inline fix16_t fix16_saturate(int64_t a) {
+    if (a > FIX16_MAXIMUM) {
+        return FIX16_MAXIMUM;
+    }
+    if (a < FIX16_MINIMUM) {
+        return FIX16_MINIMUM;
+    }
+    return (fix16_t)a;
+}
+
+static inline fix16_t fix16_mul(fix16_t a, fix16_t b) {
+    int64_t product = (int64_t)a * b;
+    return fix16_saturate((product + 0x8000) >> 16);
+}
+
+static fix16_t fix16_div(fix16_t a, fix16_t b) {
+    if (b == 0) {
+        return (a >= 0) ? FIX16_MAXIMUM : FIX16_MINIMUM;
+    }
+    int64_t num = (int64_t)a * FIX16_ONE;
+    int64_t half = ((b > 0) ? (int64_t)b : -(int64_t)b) / 2;
+    num += (num >= 0) ? half : -half;  // Round to nearest
+    return fix16_saturate(num / b);
+}
+
+/*
+ * Square root of a non negative Q16.16 value given with 64 bits, so the
+ * caller can pass sums that do not fit in fix16_t. Bit by bit integer square
+ * root of (a << 16), which is the result directly in Q16.16.
+ */
+static fix16_t fix16_sqrt64(int64_t a) {
+    if (a <= 0) {
+        return 0;
+    }
+    uint64_t num = (uint64_t)a << 16;
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > num) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (num >= result + bit) {
+            num -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    // Round to nearest instead of truncating: the std estimator feeds its
+    // own output back every sample and would drift down otherwise
+    if (num > result) {
+        result++;
+    }
+    return fix16_saturate((int64_t)result);
+}
+
+static inline fix16_t fix16_sqrt(fix16_t a) {
+    return fix16_sqrt64(a);
+}
+
+/*
+ * Unsigned Q0.32 factors, for the variance update: its gamma is around 2e-5
+ * and would keep only one or two significant digits in Q16.16.
+ */
+static inline uint32_t q32_from_float(float a) {
+    return (uint32_t)((double)a * 4294967296.0 + 0.5);
+}
+
+// a * b for a Q0.32 factor b, without a 64 x 64 bit product
+static inline uint64_t q32_mul(uint64_t a, uint32_t b) {
+    return (a >> 32) * b + (((a & 0xFFFFFFFFu) * b + 0x80000000u) >> 32);
+}
+
+/*
+ * e^-x for x >= 0. x = n + k/16 + r with r < 1/16:
+ * e^-x = e^-n * e^-(k/16) * (1 - r + r^2/2 - r^3/6), the truncation error of
+ * the polynomial is below 1e-6. Below e^-12 the result is under half a LSB.
+ */
+static const uint32_t exp_neg_int[12] = {65536, 24109, 8869, 3263, 1200, 442,
+                                         162,   60,    22,   8,    3,    1};
+static const uint32_t exp_neg_frac[16] = {
+    65536, 61565, 57835, 54331, 51039, 47947, 45042, 42313,
+    39750, 37341, 35079, 32954, 30957, 29081, 27319, 25664};
+
+static fix16_t fix16_exp_neg(fix16_t x) {
+    if (x <= 0) {
+        return FIX16_ONE;
+    }
+    if (x >= F16(12.f)) {
+        return 0;
+    }
+    uint32_t n = (uint32_t)x >> 16;
+    uint32_t k = ((uint32_t)x >> 12) & 0xF;
+    uint32_t r = (uint32_t)x & 0xFFF;
+    uint32_t r2 = (r * r) >> 16;
+    uint32_t r3 = (r2 * r) >> 16;
+    uint32_t poly = FIX16_ONE - r + (r2 >> 1) - (r3 / 6);
+
+    // Only e^-0 * e^-0 reaches 2^32; the product with poly never does,
+    // since poly < 1 whenever r != 0
+    uint32_t value = (n == 0 && k == 0)
+                         ? FIX16_ONE
+                         : (exp_neg_int[n] * exp_neg_frac[k] + 0x8000) >> 16;
+    if (r != 0) {
+        value = (value * poly + 0x8000) >> 16;
+    }
+    return (fix16_t)value;
+}
+
+/*
+ * 1 / (1 + e^x). Only e^-|x| is evaluated (always <= 1) and the other side
+ * comes from sigmoid(x) = 1 - sigmoid(-x). The division fits in 32 bits.
+ */
+static fix16_t fix16_sigmoid(fix16_t x) {
+    fix16_t e = fix16_exp_neg((x < 0) ? -x : x);
+    uint32_t d = (uint32_t)(FIX16_ONE + e);
+    // sigmoid(-|x|) = 2^32 / d, rounded to nearest
+    uint32_t low = 0xFFFFFFFFu / d;
+    uint32_t rest = 0xFFFFFFFFu - low * d + 1;
+    if (2 * rest >= d) {
+        low++;
+    }
+    return (x < 0) ? (fix16_t)low : (FIX16_ONE - (fix16_t)low);
+}
+
+static void GasIndexAlgorithm__init_instances(GasIndexAlgorithmParams* params);
+static void GasIndexAlgorithm__mean_variance_estimator__set_parameters(
+    GasIndexAlgorithmParams* params);
+static void GasIndexAlgorithm__mean_variance_estimator__set_states(
+    GasIndexAlgorithmParams* params, fix16_t mean, fix16_t std,
+    fix16_t uptime_gamma);
+static fix16_t GasIndexAlgorithm__mean_variance_estimator__get_std(
+    const GasIndexAlgorithmParams* params);
+static fix16_t GasIndexAlgorithm__mean_variance_estimator__get_mean(
+    const GasIndexAlgorithmParams* params);
+static bool GasIndexAlgorithm__mean_variance_estimator__is_initialized(
+    GasIndexAlgorithmParams* params);
+static void GasIndexAlgorithm__mean_variance_estimator___calculate_gamma(
+    GasIndexAlgorithmParams* params);
+static void GasIndexAlgorithm__mean_variance_estimator__process(
+    GasIndexAlgorithmParams* params, fix16_t sraw);
+static void
+GasIndexAlgorithm__mean_variance_estimator___sigmoid__set_parameters(
+    GasIndexAlgorithmParams* params, fix16_t X0, fix16_t K);
+static fix16_t GasIndexAlgorithm__mean_variance_estimator___sigmoid__process(
+    GasIndexAlgorithmParams* params, fix16_t sample);
+static void
+GasIndexAlgorithm__mox_model__set_parameters(GasIndexAlgorithmParams* params,
+                                             fix16_t SRAW_STD,
+                                             fix16_t SRAW_MEAN);
+static fix16_t
+GasIndexAlgorithm__mox_model__process(GasIndexAlgorithmParams* params,
+                                      fix16_t sraw);
+static void GasIndexAlgorithm__sigmoid_scaled__set_parameters(
+    GasIndexAlgorithmParams* params, fix16_t X0, fix16_t K,
+    fix16_t offset_default);
+static fix16_t
+GasIndexAlgorithm__sigmoid_scaled__process(GasIndexAlgorithmParams* params,
+                                           fix16_t sample);
+static void GasIndexAlgorithm__adaptive_lowpass__set_parameters(
+    GasIndexAlgorithmParams* params);
+static fix16_t
+GasIndexAlgorithm__adaptive_lowpass__process(GasIndexAlgorithmParams* params,
+                                             fix16_t sample);
+
+void GasIndexAlgorithm_init_with_sampling_interval(
+    GasIndexAlgorithmParams* params, int32_t algorithm_type,
+    float sampling_interval) {
+    params->mAlgorithm_Type = algorithm_type;
+    params->mSamplingInterval = fix16_from_float(sampling_interval);
+    if ((algorithm_type == GasIndexAlgorithm_ALGORITHM_TYPE_NOX)) {
+        params->mIndex_Offset = F16(GasIndexAlgorithm_NOX_INDEX_OFFSET_DEFAULT);
+        params->mSraw_Minimum = GasIndexAlgorithm_NOX_SRAW_MINIMUM;
+        params->mGating_Max_Duration_Minutes =
+            F16(GasIndexAlgorithm_GATING_NOX_MAX_DURATION_MINUTES);
+        params->mInit_Duration_Mean =
+            F16(GasIndexAlgorithm_INIT_DURATION_MEAN_NOX);
+        params->mInit_Duration_Variance =
+            F16(GasIndexAlgorithm_INIT_DURATION_VARIANCE_NOX);
+        params->mGating_Threshold = F16(GasIndexAlgorithm_GATING_THRESHOLD_NOX);
+    } else {
+        params->mIndex_Offset = F16(GasIndexAlgorithm_VOC_INDEX_OFFSET_DEFAULT);
+        params->mSraw_Minimum = GasIndexAlgorithm_VOC_SRAW_MINIMUM;
+        params->mGating_Max_Duration_Minutes =
+            F16(GasIndexAlgorithm_GATING_VOC_MAX_DURATION_MINUTES);
+        params->mInit_Duration_Mean =
+            F16(GasIndexAlgorithm_INIT_DURATION_MEAN_VOC);
+        params->mInit_Duration_Variance =
+            F16(GasIndexAlgorithm_INIT_DURATION_VARIANCE_VOC);
+        params->mGating_Threshold = F16(GasIndexAlgorithm_GATING_THRESHOLD_VOC);
+    }
+    params->mIndex_Gain = F16(GasIndexAlgorithm_INDEX_GAIN);
+    params->mTau_Mean_Hours = F16(GasIndexAlgorithm_TAU_MEAN_HOURS);
+    params->mTau_Variance_Hours = F16(GasIndexAlgorithm_TAU_VARIANCE_HOURS);
+    params->mSraw_Std_Initial = F16(GasIndexAlgorithm_SRAW_STD_INITIAL);
+    GasIndexAlgorithm_reset(params);
+}
+
+void GasIndexAlgorithm_init(GasIndexAlgorithmParams* params,
+                            int32_t algorithm_type) {
+    GasIndexAlgorithm_init_with_sampling_interval(
+        params, algorithm_type, GasIndexAlgorithm_DEFAULT_SAMPLING_INTERVAL);
+}
+
+void GasIndexAlgorithm_reset(GasIndexAlgorithmParams* params) {
+    params->mUptime = F16(0.f);
+    params->mSraw = F16(0.f);
+    params->mGas_Index = 0;
+    GasIndexAlgorithm__init_instances(params);
+}
+
+static void GasIndexAlgorithm__init_instances(GasIndexAlgorithmParams* params) {
+    GasIndexAlgorithm__mean_variance_estimator__set_parameters(params);
+    GasIndexAlgorithm__mox_model__set_parameters(
+        params, GasIndexAlgorithm__mean_variance_estimator__get_std(params),
+        GasIndexAlgorithm__mean_variance_estimator__get_mean(params));
+    if ((params->mAlgorithm_Type == GasIndexAlgorithm_ALGORITHM_TYPE_NOX)) {
+        GasIndexAlgorithm__sigmoid_scaled__set_parameters(
+            params, F16(GasIndexAlgorithm_SIGMOID_X0_NOX),
+            F16(GasIndexAlgorithm_SIGMOID_K_NOX),
+            F16(GasIndexAlgorithm_NOX_INDEX_OFFSET_DEFAULT));
+    } else {
+        GasIndexAlgorithm__sigmoid_scaled__set_parameters(
+            params, F16(GasIndexAlgorithm_SIGMOID_X0_VOC),
+            F16(GasIndexAlgorithm_SIGMOID_K_VOC),
+            F16(GasIndexAlgorithm_VOC_INDEX_OFFSET_DEFAULT));
+    }
+    GasIndexAlgorithm__adaptive_lowpass__set_parameters(params);
+}
+
+void GasIndexAlgorithm_get_sampling_interval(
+    const GasIndexAlgorithmParams* params, float* sampling_interval) {
+    *sampling_interval = fix16_to_float(params->mSamplingInterval);
+}
+
+void GasIndexAlgorithm_get_states(const GasIndexAlgorithmParams* params,
+                                  float* state0, float* state1) {
+    *state0 = fix16_to_float(
+        GasIndexAlgorithm__mean_variance_estimator__get_mean(params));
+    *state1 = fix16_to_float(
+        GasIndexAlgorithm__mean_variance_estimator__get_std(params));
+    return;
+}
+
+void GasIndexAlgorithm_set_states(GasIndexAlgorithmParams* params, float state0,
+                                  float state1) {
+    GasIndexAlgorithm__mean_variance_estimator__set_states(
+        params, fix16_from_float(state0), fix16_from_float(state1),
+        F16(GasIndexAlgorithm_PERSISTENCE_UPTIME_GAMMA));
+    GasIndexAlgorithm__mox_model__set_parameters(
+        params, GasIndexAlgorithm__mean_variance_estimator__get_std(params),
+        GasIndexAlgorithm__mean_variance_estimator__get_mean(params));
+    params->mSraw = fix16_from_float(state0);
+}
+
+void GasIndexAlgorithm_set_tuning_parameters(
+    GasIndexAlgorithmParams* params, int32_t index_offset,
+    int32_t learning_time_offset_hours, int32_t learning_time_gain_hours,
+    int32_t gating_max_duration_minutes, int32_t std_initial,
+    int32_t gain_factor) {
+    params->mIndex_Offset = fix16_from_int(index_offset);
+    params->mTau_Mean_Hours = fix16_from_int(learning_time_offset_hours);
+    params->mTau_Variance_Hours = fix16_from_int(learning_time_gain_hours);
+    params->mGating_Max_Duration_Minutes =
+        fix16_from_int(gating_max_duration_minutes);
+    params->mSraw_Std_Initial = fix16_from_int(std_initial);
+    params->mIndex_Gain = fix16_from_int(gain_factor);
+    GasIndexAlgorithm__init_instances(params);
+}
+
+void GasIndexAlgorithm_get_tuning_parameters(
+    const GasIndexAlgorithmParams* params, int32_t* index_offset,
+    int32_t* learning_time_offset_hours, int32_t* learning_time_gain_hours,
+    int32_t* gating_max_duration_minutes, int32_t* std_initial,
+    int32_t* gain_factor) {
+    *index_offset = (params->mIndex_Offset >> 16);
+    *learning_time_offset_hours = (params->mTau_Mean_Hours >> 16);
+    *learning_time_gain_hours = (params->mTau_Variance_Hours >> 16);
+    *gating_max_duration_minutes =
+        (params->mGating_Max_Duration_Minutes >> 16);
+    *std_initial = (params->mSraw_Std_Initial >> 16);
+    *gain_factor = (params->mIndex_Gain >> 16);
+    return;
+}
+
+void GasIndexAlgorithm_process(GasIndexAlgorithmParams* params, int32_t sraw,
+                               int32_t* gas_index) {
+    if ((params->mUptime <= F16(GasIndexAlgorithm_INITIAL_BLACKOUT))) {
+        params->mUptime = (params->mUptime + params->mSamplingInterval);
+    } else {
+        if (((sraw > 0) && (sraw < 65000))) {
+            if ((sraw < (params->mSraw_Minimum + 1))) {
+                sraw = (params->mSraw_Minimum + 1);
+            } else if ((sraw > (params->mSraw_Minimum + 32767))) {
+                sraw = (params->mSraw_Minimum + 32767);
+            }
+            params->mSraw = fix16_from_int((sraw - params->mSraw_Minimum));
+        }
+        if (((params->mAlgorithm_Type ==
+              GasIndexAlgorithm_ALGORITHM_TYPE_VOC) ||
+             GasIndexAlgorithm__mean_variance_estimator__is_initialized(
+                 params))) {
+            params->mGas_Index =
+                GasIndexAlgorithm__mox_model__process(params, params->mSraw);
+            params->mGas_Index = GasIndexAlgorithm__sigmoid_scaled__process(
+                params, params->mGas_Index);
+        } else {
+            params->mGas_Index = params->mIndex_Offset;
+        }
+        params->mGas_Index = GasIndexAlgorithm__adaptive_lowpass__process(
+            params, params->mGas_Index);
+        if ((params->mGas_Index < F16(0.5f))) {
+            params->mGas_Index = F16(0.5f);
+        }
+        if ((params->mSraw > F16(0.f))) {
+            GasIndexAlgorithm__mean_variance_estimator__process(params,
+                                                                params->mSraw);
+            GasIndexAlgorithm__mox_model__set_parameters(
+                params,
+                GasIndexAlgorithm__mean_variance_estimator__get_std(params),
+                GasIndexAlgorithm__mean_variance_estimator__get_mean(params));
+        }
+    }
+    *gas_index = ((params->mGas_Index + F16(0.5f)) >> 16);
+    return;
+}
+
+static void GasIndexAlgorithm__mean_variance_estimator__set_parameters(
+    GasIndexAlgorithmParams* params) {
+    // The gammas are too small for Q16.16 arithmetic to derive them exactly,
+    // so they are computed in float here (once) and only stored as fix16_t
+    float sampling_interval = fix16_to_float(params->mSamplingInterval);
+    float tau_mean_hours = fix16_to_float(params->mTau_Mean_Hours);
+    float tau_variance_hours = fix16_to_float(params->mTau_Variance_Hours);
+    float tau_initial_mean =
+        (params->mAlgorithm_Type == GasIndexAlgorithm_ALGORITHM_TYPE_NOX)
+            ? GasIndexAlgorithm_TAU_INITIAL_MEAN_NOX
+            : GasIndexAlgorithm_TAU_INITIAL_MEAN_VOC;
+
+    params->m_Mean_Variance_Estimator___Initialized = false;
+    params->m_Mean_Variance_Estimator___Mean = F16(0.f);
+    params->m_Mean_Variance_Estimator___Sraw_Offset = F16(0.f);
+    params->m_Mean_Variance_Estimator___Std = params->mSraw_Std_Initial;
+    params->m_Mean_Variance_Estimator___Gamma_Mean = fix16_from_float(
+        ((GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__ADDITIONAL_GAMMA_MEAN_SCALING *
+          GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING) *
+         (sampling_interval / 3600.f)) /
+        (tau_mean_hours + (sampling_interval / 3600.f)));
+    // The variance gammas are stored divided by GAMMA_SCALING and in Q0.32,
+    // which is the weight the variance update uses (see q32_mul)
+    params->m_Mean_Variance_Estimator___Gamma_Variance =
+        (fix16_t)q32_from_float(
+            (sampling_interval / 3600.f) /
+            (tau_variance_hours + (sampling_interval / 3600.f)));
+    params->m_Mean_Variance_Estimator___Gamma_Initial_Mean = fix16_from_float(
+        ((GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__ADDITIONAL_GAMMA_MEAN_SCALING *
+          GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING) *
+         sampling_interval) /
+        (tau_initial_mean + sampling_interval));
+    params->m_Mean_Variance_Estimator___Gamma_Initial_Variance =
+        (fix16_t)q32_from_float(
+            sampling_interval /
+            (GasIndexAlgorithm_TAU_INITIAL_VARIANCE + sampling_interval));
+    params->m_Mean_Variance_Estimator__Gamma_Mean = F16(0.f);
+    params->m_Mean_Variance_Estimator__Gamma_Variance = F16(0.f);
+    params->m_Mean_Variance_Estimator___Uptime_Gamma = F16(0.f);
+    params->m_Mean_Variance_Estimator___Uptime_Gating = F16(0.f);
+    params->m_Mean_Variance_Estimator___Gating_Duration_Minutes = F16(0.f);
+}
+
+static void GasIndexAlgorithm__mean_variance_estimator__set_states(
+    GasIndexAlgorithmParams* params, fix16_t mean, fix16_t std,
+    fix16_t uptime_gamma) {
+    params->m_Mean_Variance_Estimator___Mean = mean;
+    params->m_Mean_Variance_Estimator___Std = std;
+    params->m_Mean_Variance_Estimator___Uptime_Gamma = uptime_gamma;
+    params->m_Mean_Variance_Estimator___Initialized = true;
+}
+
+static fix16_t GasIndexAlgorithm__mean_variance_estimator__get_std(
+    const GasIndexAlgorithmParams* params) {
+    return params->m_Mean_Variance_Estimator___Std;
+}
+
+static fix16_t GasIndexAlgorithm__mean_variance_estimator__get_mean(
+    const GasIndexAlgorithmParams* params) {
+    return (params->m_Mean_Variance_Estimator___Mean +
+            params->m_Mean_Variance_Estimator___Sraw_Offset);
+}
+
+static bool GasIndexAlgorithm__mean_variance_estimator__is_initialized(
+    GasIndexAlgorithmParams* params) {
+    return params->m_Mean_Variance_Estimator___Initialized;
+}
+
+static void GasIndexAlgorithm__mean_variance_estimator___calculate_gamma(
+    GasIndexAlgorithmParams* params) {
+    fix16_t uptime_limit;
+    fix16_t sigmoid_gamma_mean;
+    fix16_t gamma_mean;
+    fix16_t gating_threshold_mean;
+    fix16_t sigmoid_gating_mean;
+    fix16_t sigmoid_gamma_variance;
+    fix16_t gamma_variance;
+    fix16_t gating_threshold_variance;
+    fix16_t sigmoid_gating_variance;
+
+    uptime_limit = (F16(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__FIX16_MAX) -
+                    params->mSamplingInterval);
+    if ((params->m_Mean_Variance_Estimator___Uptime_Gamma < uptime_limit)) {
+        params->m_Mean_Variance_Estimator___Uptime_Gamma =
+            (params->m_Mean_Variance_Estimator___Uptime_Gamma +
+             params->mSamplingInterval);
+    }
+    if ((params->m_Mean_Variance_Estimator___Uptime_Gating < uptime_limit)) {
+        params->m_Mean_Variance_Estimator___Uptime_Gating =
+            (params->m_Mean_Variance_Estimator___Uptime_Gating +
+             params->mSamplingInterval);
+    }
+    GasIndexAlgorithm__mean_variance_estimator___sigmoid__set_parameters(
+        params, params->mInit_Duration_Mean,
+        F16(GasIndexAlgorithm_INIT_TRANSITION_MEAN));
+    sigmoid_gamma_mean =
+        GasIndexAlgorithm__mean_variance_estimator___sigmoid__process(
+            params, params->m_Mean_Variance_Estimator___Uptime_Gamma);
+    gamma_mean = (params->m_Mean_Variance_Estimator___Gamma_Mean +
+                  fix16_mul(
+                      (params->m_Mean_Variance_Estimator___Gamma_Initial_Mean -
+                       params->m_Mean_Variance_Estimator___Gamma_Mean),
+                      sigmoid_gamma_mean));
+    gating_threshold_mean =
+        (params->mGating_Threshold +
+         fix16_mul(
+             (F16(GasIndexAlgorithm_GATING_THRESHOLD_INITIAL) -
+              params->mGating_Threshold),
+             GasIndexAlgorithm__mean_variance_estimator___sigmoid__process(
+                 params, params->m_Mean_Variance_Estimator___Uptime_Gating)));
+    GasIndexAlgorithm__mean_variance_estimator___sigmoid__set_parameters(
+        params, gating_threshold_mean,
+        F16(GasIndexAlgorithm_GATING_THRESHOLD_TRANSITION));
+    sigmoid_gating_mean =
+        GasIndexAlgorithm__mean_variance_estimator___sigmoid__process(
+            params, params->mGas_Index);
+    params->m_Mean_Variance_Estimator__Gamma_Mean =
+        fix16_mul(sigmoid_gating_mean, gamma_mean);
+    GasIndexAlgorithm__mean_variance_estimator___sigmoid__set_parameters(
+        params, params->mInit_Duration_Variance,
+        F16(GasIndexAlgorithm_INIT_TRANSITION_VARIANCE));
+    sigmoid_gamma_variance =
+        GasIndexAlgorithm__mean_variance_estimator___sigmoid__process(
+            params, params->m_Mean_Variance_Estimator___Uptime_Gamma);
+    // Q0.32 times Q16.16 gives Q0.32 again, so fix16_mul still applies
+    gamma_variance =
+        (params->m_Mean_Variance_Estimator___Gamma_Variance +
+         fix16_mul(
+             (params->m_Mean_Variance_Estimator___Gamma_Initial_Variance -
+              params->m_Mean_Variance_Estimator___Gamma_Variance),
+             (sigmoid_gamma_variance - sigmoid_gamma_mean)));
+    gating_threshold_variance =
+        (params->mGating_Threshold +
+         fix16_mul(
+             (F16(GasIndexAlgorithm_GATING_THRESHOLD_INITIAL) -
+              params->mGating_Threshold),
+             GasIndexAlgorithm__mean_variance_estimator___sigmoid__process(
+                 params, params->m_Mean_Variance_Estimator___Uptime_Gating)));
+    GasIndexAlgorithm__mean_variance_estimator___sigmoid__set_parameters(
+        params, gating_threshold_variance,
+        F16(GasIndexAlgorithm_GATING_THRESHOLD_TRANSITION));
+    sigmoid_gating_variance =
+        GasIndexAlgorithm__mean_variance_estimator___sigmoid__process(
+            params, params->mGas_Index);
+    params->m_Mean_Variance_Estimator__Gamma_Variance =
+        fix16_mul(sigmoid_gating_variance, gamma_variance);
+    params->m_Mean_Variance_Estimator___Gating_Duration_Minutes =
+        (params->m_Mean_Variance_Estimator___Gating_Duration_Minutes +
+         fix16_mul(fix16_mul(params->mSamplingInterval, F16(1.f / 60.f)),
+                   (fix16_mul((FIX16_ONE - sigmoid_gating_mean),
+                              F16(1.f + GasIndexAlgorithm_GATING_MAX_RATIO)) -
+                    F16(GasIndexAlgorithm_GATING_MAX_RATIO))));
+    if ((params->m_Mean_Variance_Estimator___Gating_Duration_Minutes <
+         F16(0.f))) {
+        params->m_Mean_Variance_Estimator___Gating_Duration_Minutes = F16(0.f);
+    }
+    if ((params->m_Mean_Variance_Estimator___Gating_Duration_Minutes >
+         params->mGating_Max_Duration_Minutes)) {
+        params->m_Mean_Variance_Estimator___Uptime_Gating = F16(0.f);
+    }
+}
+
+static void GasIndexAlgorithm__mean_variance_estimator__process(
+    GasIndexAlgorithmParams* params, fix16_t sraw) {
+    fix16_t delta_sgp;
+    uint32_t gamma;
+    int64_t deviation;
+    uint64_t variance;
+    uint64_t innovation;
+
+    if ((params->m_Mean_Variance_Estimator___Initialized == false)) {
+        params->m_Mean_Variance_Estimator___Initialized = true;
+        params->m_Mean_Variance_Estimator___Sraw_Offset = sraw;
+        params->m_Mean_Variance_Estimator___Mean = F16(0.f);
+    } else {
+        if (((params->m_Mean_Variance_Estimator___Mean >= F16(100.f)) ||
+             (params->m_Mean_Variance_Estimator___Mean <= F16(-100.f)))) {
+            params->m_Mean_Variance_Estimator___Sraw_Offset =
+                (params->m_Mean_Variance_Estimator___Sraw_Offset +
+                 params->m_Mean_Variance_Estimator___Mean);
+            params->m_Mean_Variance_Estimator___Mean = F16(0.f);
+        }
+        sraw = (sraw - params->m_Mean_Variance_Estimator___Sraw_Offset);
+        GasIndexAlgorithm__mean_variance_estimator___calculate_gamma(params);
+        delta_sgp = fix16_mul(
+            (sraw - params->m_Mean_Variance_Estimator___Mean),
+            F16(1.f /
+                GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING));
+        // The float update reduces to
+        // std^2 = (1 - g) * std^2 + g * (1 - g) * (sraw - mean)^2
+        // with g = gamma_variance / GAMMA_SCALING. The decay per sample (about
+        // 2e-5) is below the rounding of sqrt(64 - gamma) in Q16.16, which
+        // made std drift by more than 1% after a few days; so the variance is
+        // a 64 bit Q16 value and g is Q0.32. Without the fix16_t range limit
+        // the additional scaling of the float code is not needed either
+        gamma = (uint32_t)params->m_Mean_Variance_Estimator__Gamma_Variance;
+        deviation = (int64_t)(sraw - params->m_Mean_Variance_Estimator___Mean);
+        variance = (uint64_t)((int64_t)params->m_Mean_Variance_Estimator___Std *
+                              params->m_Mean_Variance_Estimator___Std);
+        variance = (variance + 0x8000) >> 16;
+        innovation = q32_mul((uint64_t)(deviation * deviation + 0x8000) >> 16,
+                             gamma);
+        variance = variance - q32_mul(variance, gamma) + innovation -
+                   q32_mul(innovation, gamma);
+        params->m_Mean_Variance_Estimator___Std =
+            fix16_sqrt64((int64_t)variance);
+        params->m_Mean_Variance_Estimator___Mean =
+            (params->m_Mean_Variance_Estimator___Mean +
+             fix16_mul(
+                 fix16_mul(params->m_Mean_Variance_Estimator__Gamma_Mean,
+                           delta_sgp),
+                 F16(1.f /
+                     GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__ADDITIONAL_GAMMA_MEAN_SCALING)));
+    }
+}
+
+static void
+GasIndexAlgorithm__mean_variance_estimator___sigmoid__set_parameters(
+    GasIndexAlgorithmParams* params, fix16_t X0, fix16_t K) {
+    params->m_Mean_Variance_Estimator___Sigmoid__K = K;
+    params->m_Mean_Variance_Estimator___Sigmoid__X0 = X0;
+}
+
+static fix16_t GasIndexAlgorithm__mean_variance_estimator___sigmoid__process(
+    GasIndexAlgorithmParams* params, fix16_t sample) {
+    fix16_t x;
+
+    x = fix16_mul(params->m_Mean_Variance_Estimator___Sigmoid__K,
+                  (sample - params->m_Mean_Variance_Estimator___Sigmoid__X0));
+    if ((x < F16(-50.f))) {
+        return FIX16_ONE;
+    } else if ((x > F16(50.f))) {
+        return F16(0.f);
+    } else {
+        return fix16_sigmoid(x);
+    }
+}
+
+static void
+GasIndexAlgorithm__mox_model__set_parameters(GasIndexAlgorithmParams* params,
+                                             fix16_t SRAW_STD,
+                                             fix16_t SRAW_MEAN) {
+    params->m_Mox_Model__Sraw_Std = SRAW_STD;
+    params->m_Mox_Model__Sraw_Mean = SRAW_MEAN;
+}
+
+static fix16_t
+GasIndexAlgorithm__mox_model__process(GasIndexAlgorithmParams* params,
+                                      fix16_t sraw) {
+    if ((params->mAlgorithm_Type == GasIndexAlgorithm_ALGORITHM_TYPE_NOX)) {
+        return fix16_mul(fix16_div((sraw - params->m_Mox_Model__Sraw_Mean),
+                                   F16(GasIndexAlgorithm_SRAW_STD_NOX)),
+                         params->mIndex_Gain);
+    } else {
+        return fix16_mul(
+            fix16_div((sraw - params->m_Mox_Model__Sraw_Mean),
+                      (-(params->m_Mox_Model__Sraw_Std +
+                         F16(GasIndexAlgorithm_SRAW_STD_BONUS_VOC)))),
+            params->mIndex_Gain);
+    }
+}
+
+static void GasIndexAlgorithm__sigmoid_scaled__set_parameters(
+    GasIndexAlgorithmParams* params, fix16_t X0, fix16_t K,
+    fix16_t offset_default) {
+    params->m_Sigmoid_Scaled__K = K;
+    params->m_Sigmoid_Scaled__X0 = X0;
+    params->m_Sigmoid_Scaled__Offset_Default = offset_default;
+}
+
+static fix16_t
+GasIndexAlgorithm__sigmoid_scaled__process(GasIndexAlgorithmParams* params,
+                                           fix16_t sample) {
+    fix16_t x;
+    fix16_t shift;
+
+    x = fix16_mul(params->m_Sigmoid_Scaled__K,
+                  (sample - params->m_Sigmoid_Scaled__X0));
+    if ((x < F16(-50.f))) {
+        return F16(GasIndexAlgorithm_SIGMOID_L);
+    } else if ((x > F16(50.f))) {
+        return F16(0.f);
+    } else {
+        if ((sample >= F16(0.f))) {
+            if ((params->m_Sigmoid_Scaled__Offset_Default == FIX16_ONE)) {
+                shift = fix16_mul(F16(500.f / 499.f),
+                                  (FIX16_ONE - params->mIndex_Offset));
+            } else {
+                shift = ((F16(GasIndexAlgorithm_SIGMOID_L) -
+                          (5 * params->mIndex_Offset)) /
+                         4);
+            }
+            return (fix16_mul((F16(GasIndexAlgorithm_SIGMOID_L) + shift),
+                              fix16_sigmoid(x)) -
+                    shift);
+        } else {
+            return fix16_mul(
+                fix16_div(params->mIndex_Offset,
+                          params->m_Sigmoid_Scaled__Offset_Default),
+                fix16_mul(F16(GasIndexAlgorithm_SIGMOID_L), fix16_sigmoid(x)));
+        }
+    }
+}
+
+static void GasIndexAlgorithm__adaptive_lowpass__set_parameters(
+    GasIndexAlgorithmParams* params) {
+    params->m_Adaptive_Lowpass__A1 =
+        fix16_div(params->mSamplingInterval,
+                  (F16(GasIndexAlgorithm_LP_TAU_FAST) +
+                   params->mSamplingInterval));
+    params->m_Adaptive_Lowpass__A2 =
+        fix16_div(params->mSamplingInterval,
+                  (F16(GasIndexAlgorithm_LP_TAU_SLOW) +
+                   params->mSamplingInterval));
+    params->m_Adaptive_Lowpass___Initialized = false;
+}
+
+static fix16_t
+GasIndexAlgorithm__adaptive_lowpass__process(GasIndexAlgorithmParams* params,
+                                             fix16_t sample) {
+    fix16_t abs_delta;
+    fix16_t F1;
+    fix16_t tau_a;
+    fix16_t a3;
+
+    if ((params->m_Adaptive_Lowpass___Initialized == false)) {
+        params->m_Adaptive_Lowpass___X1 = sample;
+        params->m_Adaptive_Lowpass___X2 = sample;
+        params->m_Adaptive_Lowpass___X3 = sample;
+        params->m_Adaptive_Lowpass___Initialized = true;
+    }
+    // x = (1 - a) * x + a * sample, written as x + a * (sample - x) so that
+    // the slow filter does not lose its small updates to rounding twice
+    params->m_Adaptive_Lowpass___X1 =
+        (params->m_Adaptive_Lowpass___X1 +
+         fix16_mul(params->m_Adaptive_Lowpass__A1,
+                   (sample - params->m_Adaptive_Lowpass___X1)));
+    params->m_Adaptive_Lowpass___X2 =
+        (params->m_Adaptive_Lowpass___X2 +
+         fix16_mul(params->m_Adaptive_Lowpass__A2,
+                   (sample - params->m_Adaptive_Lowpass___X2)));
+    abs_delta =
+        (params->m_Adaptive_Lowpass___X1 - params->m_Adaptive_Lowpass___X2);
+    if ((abs_delta < F16(0.f))) {
+        abs_delta = (-abs_delta);
+    }
+    F1 = fix16_exp_neg(fix16_mul(F16(-GasIndexAlgorithm_LP_ALPHA), abs_delta));
+    tau_a = (fix16_mul(F16((GasIndexAlgorithm_LP_TAU_SLOW -
+                            GasIndexAlgorithm_LP_TAU_FAST)),
+                       F1) +
+             F16(GasIndexAlgorithm_LP_TAU_FAST));
+    a3 = fix16_div(params->mSamplingInterval,
+                   (params->mSamplingInterval + tau_a));
+    params->m_Adaptive_Lowpass___X3 =
+        (params->m_Adaptive_Lowpass___X3 +
+         fix16_mul(a3, (sample - params->m_Adaptive_Lowpass___X3)));
+    return params->m_Adaptive_Lowpass___X3;
+}
+
+#endif /* GAS_INDEX_ALGORITHM_FIXED_POINT */
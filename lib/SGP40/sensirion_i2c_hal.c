@@ -1,4 +1,3 @@
-#include "hardware/i2c.h"
 #include "pico/stdlib.h"
 /*
  * Copyright (c) 2018, Sensirion AG
@@ -34,10 +33,9 @@
 #include "sensirion_common.h"
 #include "sensirion_config.h"
 #include "sensirion_i2c_hal.h"
-
-#define I2C_PORT i2c0
-#define PIN_I2C_SDA 0
-#define PIN_I2C_SCL 1
+#include "I2CEngine.h"
+#include "FreeRTOS.h"
+#include "task.h"
 
 /**
  * Select the current i2c bus by index.
@@ -61,26 +59,14 @@ int16_t sensirion_i2c_hal_select_bus(uint8_t bus_idx) {
  * communication.
  */
 void sensirion_i2c_hal_init(void) {
-    stdio_init_all();
-
-    // I2C Initialisation. Using it at 400Khz.
-    i2c_init(I2C_PORT, 400 * 1000);
-
-    gpio_set_function(PIN_I2C_SDA, GPIO_FUNC_I2C);
-    gpio_set_function(PIN_I2C_SCL, GPIO_FUNC_I2C);
-    gpio_pull_up(PIN_I2C_SDA);
-    gpio_pull_up(PIN_I2C_SCL);
+    // The bus (I2C0 at 400Khz) is owned by the I2CEngine, started in main().
 }
 
 /**
  * Release all resources initialized by sensirion_i2c_hal_init().
  */
 void sensirion_i2c_hal_free(void) {
-    i2c_deinit(I2C_PORT);
-    gpio_set_function(PIN_I2C_SDA, GPIO_FUNC_NULL);
-    gpio_set_function(PIN_I2C_SCL, GPIO_FUNC_NULL);
-    gpio_disable_pulls(PIN_I2C_SDA);
-    gpio_disable_pulls(PIN_I2C_SCL);
+    // Nothing to release: the bus is shared with the other devices.
 }
 
 /**
@@ -94,7 +80,9 @@ void sensirion_i2c_hal_free(void) {
  * @returns 0 on success, error code otherwise
  */
 int8_t sensirion_i2c_hal_read(uint8_t address, uint8_t* data, uint16_t count) {
-    int status = i2c_read_blocking(I2C_PORT, address, data, count, false);
+    // Normal priority: gate expander servicing goes first.
+    int status = i2c_engine_transfer(address, NULL, 0, data, count,
+                                     I2C_PRIORITY_NORMAL);
 
     if (status <= 0)
         return 1;
@@ -115,8 +103,9 @@ int8_t sensirion_i2c_hal_read(uint8_t address, uint8_t* data, uint16_t count) {
  */
 int8_t sensirion_i2c_hal_write(uint8_t address, const uint8_t* data,
                                uint16_t count) {
-    // I2C Default is used (I2C0).
-    int status = i2c_write_blocking(I2C_PORT, address, data, count, false);
+    // I2C Default is used (I2C0), through the shared I2CEngine.
+    int status = i2c_engine_transfer(address, data, count, NULL, 0,
+                                     I2C_PRIORITY_NORMAL);
 
     if (status <= 0)
         return 1;
@@ -133,5 +122,15 @@ int8_t sensirion_i2c_hal_write(uint8_t address, const uint8_t* data,
  * @param useconds the sleep time in microseconds
  */
 void sensirion_i2c_hal_sleep_usec(uint32_t useconds) {
-    sleep_ms(useconds / 1000);
+    const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+
+    // Inside a task, yield to the scheduler for anything of at least a tick.
+    // vTaskDelay(n) may return up to one tick early, hence the extra tick.
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING &&
+        useconds >= tick_us) {
+        vTaskDelay((TickType_t)((useconds + tick_us - 1) / tick_us) + 1);
+    } else {
+        // Before the scheduler starts, or sub-tick waits: no truncation to 0
+        sleep_us(useconds);
+    }
 }
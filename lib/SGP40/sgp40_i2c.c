@@ -46,6 +46,19 @@
 int16_t sgp40_measure_raw_signal(uint16_t relative_humidity,
                                  uint16_t temperature, uint16_t* sraw_voc) {
     int16_t error;
+
+    error = sgp40_start_measure_raw_signal(relative_humidity, temperature);
+    if (error) {
+        return error;
+    }
+
+    sensirion_i2c_hal_sleep_usec(SGP40_MEASURE_RAW_SIGNAL_DURATION_US);
+
+    return sgp40_read_measure_raw_signal(sraw_voc);
+}
+
+int16_t sgp40_start_measure_raw_signal(uint16_t relative_humidity,
+                                       uint16_t temperature) {
     uint8_t buffer[8];
     uint16_t offset = 0;
     offset = sensirion_i2c_add_command_to_buffer(&buffer[0], offset, 0x260F);
@@ -55,12 +68,12 @@ int16_t sgp40_measure_raw_signal(uint16_t relative_humidity,
     offset =
         sensirion_i2c_add_uint16_t_to_buffer(&buffer[0], offset, temperature);
 
-    error = sensirion_i2c_write_data(SGP40_I2C_ADDRESS, &buffer[0], offset);
-    if (error) {
-        return error;
-    }
+    return sensirion_i2c_write_data(SGP40_I2C_ADDRESS, &buffer[0], offset);
+}
 
-    sensirion_i2c_hal_sleep_usec(30000);
+int16_t sgp40_read_measure_raw_signal(uint16_t* sraw_voc) {
+    int16_t error;
+    uint8_t buffer[3];
 
     error = sensirion_i2c_read_data_inplace(SGP40_I2C_ADDRESS, &buffer[0], 2);
     if (error) {
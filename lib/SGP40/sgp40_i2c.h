@@ -66,6 +66,38 @@ extern "C" {
 int16_t sgp40_measure_raw_signal(uint16_t relative_humidity,
                                  uint16_t temperature, uint16_t* sraw_voc);
 
+/**
+ * Conversion time of sgp40_start_measure_raw_signal(), in microseconds.
+ */
+#define SGP40_MEASURE_RAW_SIGNAL_DURATION_US 30000
+
+/**
+ * sgp40_start_measure_raw_signal() - First half of
+ * sgp40_measure_raw_signal(): only sends the command. The result can be read
+ * with sgp40_read_measure_raw_signal() at least
+ * SGP40_MEASURE_RAW_SIGNAL_DURATION_US later; the caller decides how to wait,
+ * so other work (or other sensors' conversions) can run meanwhile.
+ *
+ * @param relative_humidity see sgp40_measure_raw_signal()
+ *
+ * @param temperature see sgp40_measure_raw_signal()
+ *
+ * @return 0 on success, an error code otherwise
+ */
+int16_t sgp40_start_measure_raw_signal(uint16_t relative_humidity,
+                                       uint16_t temperature);
+
+/**
+ * sgp40_read_measure_raw_signal() - Second half of
+ * sgp40_measure_raw_signal(): reads the result of the conversion started by
+ * sgp40_start_measure_raw_signal().
+ *
+ * @param sraw_voc see sgp40_measure_raw_signal()
+ *
+ * @return 0 on success, an error code otherwise
+ */
+int16_t sgp40_read_measure_raw_signal(uint16_t* sraw_voc);
+
 /**
  * sgp40_execute_self_test() - This command triggers the built-in self-test
  * checking for integrity of the hotplate and MOX material and returns the
@@ -0,0 +1,167 @@
+#include "SensorScheduler.h"
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#define SLOT_US ((uint64_t)SENSOR_SCHEDULER_SLOT_MS * 1000u)
+
+SensorScheduler::SensorScheduler(){
+    _count = 0;
+    _task = NULL;
+    for(int i = 0; i < SENSOR_SCHEDULER_SLOTS; i++) _wheel[i] = NULL;
+}
+
+bool SensorScheduler::add(const char *name, uint32_t period_ms, uint32_t phase_ms, sensor_job_fn_t run,
+                          sensor_job_fn_t init, void *arg){
+    if(_task != NULL || _count >= SENSOR_SCHEDULER_MAX_JOBS || run == NULL) return false;
+
+    uint32_t period = (period_ms + SENSOR_SCHEDULER_SLOT_MS / 2) / SENSOR_SCHEDULER_SLOT_MS;
+    if(period == 0) period = 1;
+    job_t *job = &_jobs[_count++];
+    job->name = name;
+    job->period = period;
+    job->phase = ((phase_ms + SENSOR_SCHEDULER_SLOT_MS / 2) / SENSOR_SCHEDULER_SLOT_MS) % period;
+    job->run = run;
+    job->init = init;
+    job->arg = arg;
+    job->release = 0;
+    job->next = NULL;
+    job->stats = {0, 0, 0, 0, 0};
+    job->jitter_sum_us = 0;
+    return true;
+}
+
+bool SensorScheduler::begin(const char *name, UBaseType_t priority, UBaseType_t affinity){
+    if(_taskMemory.create(taskImpl, name, this, priority, &_task, affinity) != pdPASS){
+        printf("[SCHED] Erro ao criar o worker %s\n", name);
+        return false;
+    }
+    return true;
+}
+
+void SensorScheduler::taskImpl(void *params){
+    ((SensorScheduler *)params)->worker();
+}
+
+void SensorScheduler::insert(job_t *job){
+    // Ordem de cadastro dentro do slot (os jobs estao em sequencia no array)
+    job_t **link = &_wheel[job->release % SENSOR_SCHEDULER_SLOTS];
+    while(*link != NULL && *link < job) link = &(*link)->next;
+    job->next = *link;
+    *link = job;
+}
+
+uint64_t SensorScheduler::nextRelease(uint64_t now){
+    // Uma volta na roda; jobs mais distantes ficam no slot esperando a volta deles
+    for(uint64_t slot = now + 1; slot <= now + SENSOR_SCHEDULER_SLOTS; slot++){
+        for(job_t *job = _wheel[slot % SENSOR_SCHEDULER_SLOTS]; job != NULL; job = job->next){
+            if(job->release == slot) return slot;
+        }
+    }
+    uint64_t next = UINT64_MAX;
+    for(uint8_t i = 0; i < _count; i++){
+        if(_jobs[i].release < next) next = _jobs[i].release;
+    }
+    return next;
+}
+
+void SensorScheduler::runSlot(uint64_t slot){
+    // Separa os jobs deste instante, mantendo a ordem; os de voltas futuras ficam
+    job_t *due = NULL;
+    job_t **due_tail = &due;
+    job_t **link = &_wheel[slot % SENSOR_SCHEDULER_SLOTS];
+    while(*link != NULL){
+        job_t *job = *link;
+        if(job->release == slot){
+            *link = job->next;
+            job->next = NULL;
+            *due_tail = job;
+            due_tail = &job->next;
+        } else {
+            link = &job->next;
+        }
+    }
+
+    while(due != NULL){
+        job_t *job = due;
+        due = job->next;
+
+        uint64_t start = time_us_64();
+        job->run(job->arg);
+        uint64_t end = time_us_64();
+
+        // Proximo instante; os que ja passaram sao perdidos, sem rajada para alcancar
+        uint32_t missed = 0;
+        uint64_t now = end / SLOT_US;
+        job->release += job->period;
+        if(job->release <= now){
+            missed = (uint32_t)((now - job->release) / job->period + 1);
+            job->release += (uint64_t)missed * job->period;
+        }
+
+        uint64_t jitter = start - slot * SLOT_US;
+        uint64_t duration = end - start;
+        taskENTER_CRITICAL();
+        job->stats.runs++;
+        job->stats.overruns += missed;
+        job->jitter_sum_us += jitter;
+        job->stats.jitter_avg_us = (uint32_t)(job->jitter_sum_us / job->stats.runs);
+        if(jitter > job->stats.jitter_max_us) job->stats.jitter_max_us = (uint32_t)jitter;
+        if(duration > job->stats.duration_max_us) job->stats.duration_max_us = (uint32_t)duration;
+        taskEXIT_CRITICAL();
+
+        insert(job);
+    }
+}
+
+void SensorScheduler::worker(){
+    for(uint8_t i = 0; i < _count; i++){
+        if(_jobs[i].init != NULL) _jobs[i].init(_jobs[i].arg);
+    }
+
+    // Primeira execucao: proximo multiplo do periodo, mais a fase
+    uint64_t now = time_us_64() / SLOT_US;
+    for(uint8_t i = 0; i < _count; i++){
+        job_t *job = &_jobs[i];
+        job->release = (now / job->period + 1) * job->period + job->phase;
+        insert(job);
+    }
+
+    while(true){
+        uint64_t next = nextRelease(now);
+        if(next == UINT64_MAX){
+            vTaskSuspend(NULL); // Nenhum job cadastrado
+            continue;
+        }
+
+        // Uma acordada por instante, seja quantos forem os jobs dele. O
+        // vTaskDelay pode devolver ate 1 tick antes: confere no timer
+        int64_t wait_us;
+        while((wait_us = (int64_t)(next * SLOT_US - time_us_64())) > 0){
+            vTaskDelay(pdMS_TO_TICKS((uint32_t)(wait_us / 1000)) + 1);
+        }
+        runSlot(next);
+        now = next;
+    }
+}
+
+bool SensorScheduler::getStats(uint8_t index, const char **name, sensor_job_stats_t *stats){
+    if(index >= _count) return false;
+    *name = _jobs[index].name;
+    taskENTER_CRITICAL();
+    *stats = _jobs[index].stats;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+void SensorScheduler::printStats(){
+    const char *name;
+    sensor_job_stats_t stats;
+    for(uint8_t i = 0; i < _count; i++){
+        getStats(i, &name, &stats);
+        printf("Job %s (%lu ms): %lu execucoes, jitter %lu us (max %lu us), duracao max %lu us, %lu perdidas\n", name,
+               (unsigned long)(_jobs[i].period * SENSOR_SCHEDULER_SLOT_MS), (unsigned long)stats.runs,
+               (unsigned long)stats.jitter_avg_us, (unsigned long)stats.jitter_max_us,
+               (unsigned long)stats.duration_max_us, (unsigned long)stats.overruns);
+    }
+}
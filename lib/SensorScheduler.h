@@ -0,0 +1,74 @@
+#ifndef SENSORSCHEDULER_H
+#define SENSORSCHEDULER_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "KernelMemory.h"
+
+#define SENSOR_SCHEDULER_MAX_JOBS 8
+#define SENSOR_SCHEDULER_SLOT_MS 10  // Resolucao da roda (e do alinhamento das fases)
+#define SENSOR_SCHEDULER_SLOTS 128   // 1,28 s por volta: periodos maiores esperam voltas
+#define SENSOR_SCHEDULER_STACK 2048  // Palavras: printf de float, lote da telemetria e MQTT
+
+typedef void (*sensor_job_fn_t)(void *arg);
+
+typedef struct{
+    uint32_t runs;
+    uint32_t overruns;        // Execucoes perdidas: o worker so chegou depois da seguinte
+    uint32_t jitter_avg_us;   // Atraso do inicio em relacao ao instante planejado
+    uint32_t jitter_max_us;
+    uint32_t duration_max_us;
+} sensor_job_stats_t;
+
+// Agendador unico das amostragens periodicas: uma task (worker) e uma roda de
+// tempo com slots de SENSOR_SCHEDULER_SLOT_MS. Os instantes de cada job sao
+// multiplos do periodo desde o boot mais a fase, entao jobs de 1 s e 2 s
+// coincidem nos segundos pares e rodam na mesma acordada, na ordem de
+// cadastro: amostras de sensores diferentes saem do mesmo instante. Os
+// instantes sao absolutos (timer de 1 MHz): um atraso nao empurra os seguintes.
+// Os jobs nao devem bloquear por muito tempo; uma espera longa vira dois jobs
+// com fases diferentes (VOC: inicio da medicao e leitura 40 ms depois). Cada
+// instancia tem o seu worker, numa prioridade e num nucleo.
+class SensorScheduler{
+    private:
+        typedef struct job{
+            const char *name;
+            uint32_t period;  // Em slots
+            uint32_t phase;   // Em slots
+            sensor_job_fn_t run;
+            sensor_job_fn_t init;
+            void *arg;
+            uint64_t release; // Slot da proxima execucao, contado desde o boot
+            struct job *next; // Proximo job no mesmo slot da roda
+            sensor_job_stats_t stats;
+            uint64_t jitter_sum_us;
+        } job_t;
+
+        job_t _jobs[SENSOR_SCHEDULER_MAX_JOBS];
+        uint8_t _count;
+        job_t *_wheel[SENSOR_SCHEDULER_SLOTS];
+        TaskHandle_t _task;
+        KernelTask<SENSOR_SCHEDULER_STACK> _taskMemory;
+
+        void insert(job_t *job);
+        uint64_t nextRelease(uint64_t now);
+        void runSlot(uint64_t slot);
+        void worker();
+        static void taskImpl(void *params);
+
+    public:
+        // Construtor
+        SensorScheduler();
+
+        // Metodos
+        // Antes do begin. Periodo e fase em ms, arredondados para slots. O init
+        // roda uma vez no worker, antes da primeira execucao de qualquer job
+        bool add(const char *name, uint32_t period_ms, uint32_t phase_ms, sensor_job_fn_t run,
+                 sensor_job_fn_t init = NULL, void *arg = NULL);
+        bool begin(const char *name, UBaseType_t priority, UBaseType_t affinity = tskNO_AFFINITY);
+        bool getStats(uint8_t index, const char **name, sensor_job_stats_t *stats); // Thread-safe
+        void printStats();
+};
+
+#endif
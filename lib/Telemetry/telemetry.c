@@ -0,0 +1,273 @@
+#include "telemetry.h"
+
+#include <stdio.h>
+
+// Zigzag: valores pequenos com sinal viram varints curtos
+static uint32_t zigzag_encode(int32_t v){
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t v){
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static bool put_varint(uint8_t *buf, size_t size, size_t *pos, uint32_t v){
+    do{
+        if(*pos >= size) return false;
+        uint8_t byte = v & 0x7F;
+        v >>= 7;
+        buf[(*pos)++] = byte | (v ? 0x80 : 0);
+    } while(v);
+    return true;
+}
+
+static bool get_varint(const uint8_t *buf, size_t len, size_t *pos, uint32_t *v){
+    uint32_t result = 0;
+    for(int shift = 0; shift < 35; shift += 7){
+        if(*pos >= len) return false;
+        uint8_t byte = buf[(*pos)++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)){
+            *v = result;
+            return true;
+        }
+    }
+    return false; // Mais de 5 bytes: nao e um uint32
+}
+
+// Campos de cada tipo, comuns a mensagem avulsa e ao lote
+static bool put_fields(const telemetry_message_t *msg, uint8_t *buf, size_t size, size_t *pos){
+    switch(msg->type){
+        case TELEMETRY_BEECOUNT:
+            return put_varint(buf, size, pos, zigzag_encode(msg->data.beecount.in)) &&
+                   put_varint(buf, size, pos, zigzag_encode(msg->data.beecount.out));
+        case TELEMETRY_LOADCELL:
+            return put_varint(buf, size, pos, msg->data.loadcell.cell) &&
+                   put_varint(buf, size, pos, zigzag_encode(msg->data.loadcell.raw_cg)) &&
+                   put_varint(buf, size, pos, zigzag_encode(msg->data.loadcell.tare_cg));
+        case TELEMETRY_VOC:
+            return put_varint(buf, size, pos, zigzag_encode(msg->data.voc.index));
+        default:
+            return false;
+    }
+}
+
+static bool get_fields(const uint8_t *buf, size_t len, size_t *pos, telemetry_message_t *msg){
+    uint32_t a, b, cell;
+    switch(msg->type){
+        case TELEMETRY_BEECOUNT:
+            if(!get_varint(buf, len, pos, &a) || !get_varint(buf, len, pos, &b)) return false;
+            msg->data.beecount.in = zigzag_decode(a);
+            msg->data.beecount.out = zigzag_decode(b);
+            return true;
+        case TELEMETRY_LOADCELL:
+            if(!get_varint(buf, len, pos, &cell) || cell > UINT8_MAX) return false;
+            if(!get_varint(buf, len, pos, &a) || !get_varint(buf, len, pos, &b)) return false;
+            msg->data.loadcell.cell = (uint8_t)cell;
+            msg->data.loadcell.raw_cg = zigzag_decode(a);
+            msg->data.loadcell.tare_cg = zigzag_decode(b);
+            return true;
+        case TELEMETRY_VOC:
+            if(!get_varint(buf, len, pos, &a)) return false;
+            msg->data.voc.index = zigzag_decode(a);
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t telemetry_encode(const telemetry_message_t *msg, uint8_t *buf, size_t size){
+    size_t pos = 0;
+
+    if(size < 2 || msg->type == TELEMETRY_BATCH) return 0;
+    buf[pos++] = TELEMETRY_SCHEMA_VERSION;
+    buf[pos++] = msg->type;
+    if(!put_varint(buf, size, &pos, msg->sequence)) return 0;
+    return put_fields(msg, buf, size, &pos) ? pos : 0;
+}
+
+bool telemetry_decode(const uint8_t *buf, size_t len, telemetry_message_t *msg){
+    size_t pos = 2;
+
+    if(len < 2 || buf[0] != TELEMETRY_SCHEMA_VERSION) return false;
+    msg->type = buf[1];
+    if(!get_varint(buf, len, &pos, &msg->sequence)) return false;
+    if(!get_fields(buf, len, &pos, msg)) return false;
+    return pos == len;
+}
+
+bool telemetry_batch_init(telemetry_batch_t *batch, uint8_t *buf, size_t size, uint32_t sequence, uint32_t epoch_at_boot){
+    batch->buf = buf;
+    batch->size = size;
+    batch->length = 0;
+    batch->count = 0;
+    batch->first_ms = 0;
+    batch->last_ms = 0;
+
+    if(size < 2) return false;
+    buf[batch->length++] = TELEMETRY_SCHEMA_VERSION;
+    buf[batch->length++] = TELEMETRY_BATCH;
+    return put_varint(buf, size, &batch->length, sequence) &&
+           put_varint(buf, size, &batch->length, epoch_at_boot);
+}
+
+bool telemetry_batch_append(telemetry_batch_t *batch, const telemetry_message_t *msg, uint32_t time_ms){
+    // Grava numa copia da posicao: se nao couber, o lote fica como estava
+    size_t pos = batch->length;
+    uint32_t delta = zigzag_encode((int32_t)(time_ms - batch->last_ms));
+
+    if(pos >= batch->size || msg->type == TELEMETRY_BATCH) return false;
+    batch->buf[pos++] = msg->type;
+    if(!put_varint(batch->buf, batch->size, &pos, delta)) return false;
+    if(!put_fields(msg, batch->buf, batch->size, &pos)) return false;
+
+    if(batch->count == 0) batch->first_ms = time_ms;
+    batch->length = pos;
+    batch->last_ms = time_ms;
+    batch->count++;
+    return true;
+}
+
+bool telemetry_batch_open(telemetry_batch_reader_t *reader, const uint8_t *buf, size_t len){
+    reader->buf = buf;
+    reader->len = len;
+    reader->pos = 2;
+    reader->time_ms = 0;
+
+    if(len < 2 || buf[0] != TELEMETRY_SCHEMA_VERSION || buf[1] != TELEMETRY_BATCH) return false;
+    return get_varint(buf, len, &reader->pos, &reader->sequence) &&
+           get_varint(buf, len, &reader->pos, &reader->epoch_at_boot);
+}
+
+bool telemetry_batch_next(telemetry_batch_reader_t *reader, telemetry_message_t *msg, uint32_t *time_ms){
+    uint32_t delta;
+
+    if(reader->pos >= reader->len) return false;
+    msg->type = reader->buf[reader->pos++];
+    msg->sequence = reader->sequence;
+    if(!get_varint(reader->buf, reader->len, &reader->pos, &delta)) return false;
+    if(!get_fields(reader->buf, reader->len, &reader->pos, msg)) return false;
+
+    reader->time_ms += (uint32_t)zigzag_decode(delta);
+    *time_ms = reader->time_ms;
+    return true;
+}
+
+bool telemetry_health_init(telemetry_batch_t *msg, uint8_t *buf, size_t size, uint32_t sequence, const telemetry_health_t *health){
+    msg->buf = buf;
+    msg->size = size;
+    msg->length = 0;
+    msg->count = 0;
+    msg->first_ms = 0;
+    msg->last_ms = 0;
+
+    if(size < 2 || health->cores > TELEMETRY_HEALTH_MAX_CORES) return false;
+    buf[msg->length++] = TELEMETRY_SCHEMA_VERSION;
+    buf[msg->length++] = TELEMETRY_HEALTH;
+    if(!put_varint(buf, size, &msg->length, sequence) ||
+       !put_varint(buf, size, &msg->length, health->uptime_s) ||
+       !put_varint(buf, size, &msg->length, health->heap_free) ||
+       !put_varint(buf, size, &msg->length, health->heap_min_free) ||
+       !put_varint(buf, size, &msg->length, health->sleep_pm)) return false;
+    if(msg->length + 2 + health->cores > size) return false;
+    buf[msg->length++] = health->cores;
+    for(uint8_t i = 0; i < health->cores; i++)
+        buf[msg->length++] = health->core_busy[i];
+    buf[msg->length++] = health->task_count;
+    return true;
+}
+
+bool telemetry_health_append(telemetry_batch_t *msg, const telemetry_task_health_t *task){
+    size_t pos = msg->length;
+    size_t name_len = 0;
+    while(name_len < TELEMETRY_HEALTH_NAME_LEN && task->name[name_len]) name_len++;
+
+    if(pos + 1 + name_len > msg->size) return false;
+    msg->buf[pos++] = (uint8_t)name_len;
+    for(size_t i = 0; i < name_len; i++)
+        msg->buf[pos++] = (uint8_t)task->name[i];
+    if(!put_varint(msg->buf, msg->size, &pos, task->cpu_pm) ||
+       !put_varint(msg->buf, msg->size, &pos, task->stack_free)) return false;
+
+    msg->length = pos;
+    msg->count++;
+    return true;
+}
+
+bool telemetry_health_open(telemetry_batch_reader_t *reader, const uint8_t *buf, size_t len, telemetry_health_t *health){
+    uint32_t cores, sleep;
+
+    reader->buf = buf;
+    reader->len = len;
+    reader->pos = 2;
+    reader->time_ms = 0;
+    reader->epoch_at_boot = 0;
+
+    if(len < 2 || buf[0] != TELEMETRY_SCHEMA_VERSION || buf[1] != TELEMETRY_HEALTH) return false;
+    if(!get_varint(buf, len, &reader->pos, &reader->sequence) ||
+       !get_varint(buf, len, &reader->pos, &health->uptime_s) ||
+       !get_varint(buf, len, &reader->pos, &health->heap_free) ||
+       !get_varint(buf, len, &reader->pos, &health->heap_min_free) ||
+       !get_varint(buf, len, &reader->pos, &sleep)) return false;
+    health->sleep_pm = (uint16_t)sleep;
+    if(reader->pos >= len) return false;
+    cores = buf[reader->pos++];
+    if(cores > TELEMETRY_HEALTH_MAX_CORES || reader->pos + cores + 1 > len) return false;
+    health->cores = (uint8_t)cores;
+    for(uint32_t i = 0; i < cores; i++)
+        health->core_busy[i] = buf[reader->pos++];
+    health->task_count = buf[reader->pos++];
+    return true;
+}
+
+bool telemetry_health_next(telemetry_batch_reader_t *reader, telemetry_task_health_t *task){
+    uint32_t cpu, stack;
+    size_t name_len;
+
+    if(reader->pos >= reader->len) return false;
+    name_len = reader->buf[reader->pos++];
+    if(name_len > TELEMETRY_HEALTH_NAME_LEN || reader->pos + name_len > reader->len) return false;
+    for(size_t i = 0; i < name_len; i++)
+        task->name[i] = (char)reader->buf[reader->pos++];
+    task->name[name_len] = '\0';
+    if(!get_varint(reader->buf, reader->len, &reader->pos, &cpu) ||
+       !get_varint(reader->buf, reader->len, &reader->pos, &stack)) return false;
+    task->cpu_pm = (uint16_t)cpu;
+    task->stack_free = stack;
+    return true;
+}
+
+// Centesimos em texto sem passar pelo printf de ponto flutuante
+static const char *centi_sign(int32_t v){
+    return v < 0 ? "-" : "";
+}
+
+static unsigned long centi_abs(int32_t v){
+    return v < 0 ? (unsigned long)(-(int64_t)v) : (unsigned long)v;
+}
+
+size_t telemetry_to_json(const telemetry_message_t *msg, char *buf, size_t size){
+    int n;
+    switch(msg->type){
+        case TELEMETRY_BEECOUNT:
+            n = snprintf(buf, size, "{\"seq\": %lu, \"in\": %ld, \"out\": %ld}",
+                         (unsigned long)msg->sequence,
+                         (long)msg->data.beecount.in, (long)msg->data.beecount.out);
+            break;
+        case TELEMETRY_LOADCELL:{
+            int32_t raw = msg->data.loadcell.raw_cg, tare = msg->data.loadcell.tare_cg;
+            n = snprintf(buf, size, "{\"seq\": %lu, \"cell\": %u, \"raw\": %s%lu.%02lu, \"tare\": %s%lu.%02lu}",
+                         (unsigned long)msg->sequence, (unsigned)msg->data.loadcell.cell,
+                         centi_sign(raw), centi_abs(raw) / 100, centi_abs(raw) % 100,
+                         centi_sign(tare), centi_abs(tare) / 100, centi_abs(tare) % 100);
+            break;
+        }
+        case TELEMETRY_VOC:
+            n = snprintf(buf, size, "{\"seq\": %lu, \"index\": %ld}",
+                         (unsigned long)msg->sequence, (long)msg->data.voc.index);
+            break;
+        default:
+            return 0;
+    }
+    return (n > 0 && (size_t)n < size) ? (size_t)n : 0;
+}
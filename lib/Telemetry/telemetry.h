@@ -0,0 +1,140 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+// Codificacao binaria compacta da telemetria publicada no MQTT.
+// C puro e sem dependencias do SDK: o mesmo arquivo compila no host para
+// decodificar as mensagens (ex.: cc -c telemetry.c).
+//
+// Formato (schema 3), todos os inteiros em varint LEB128:
+//   byte 0   versao do schema (TELEMETRY_SCHEMA_VERSION)
+//   byte 1   tipo da mensagem (telemetry_type_t)
+//   varint   sequencia (por tipo, detecta mensagens perdidas)
+//   campos do tipo, na ordem da struct; inteiros com sinal em zigzag
+// O primeiro byte de um JSON e '{', entao o consumidor distingue os dois modos.
+// Qualquer mudanca de campo sobe a versao; o decodificador so aceita a atual.
+//   schema 2: tempo em sono na mensagem de saude
+//   schema 3: indice da balanca em TELEMETRY_LOADCELL
+//
+// Lote (TELEMETRY_BATCH): varias amostras com horario em um unico publish.
+//   byte 0   versao, byte 1 TELEMETRY_BATCH
+//   varint   sequencia do lote
+//   varint   hora real do boot (s desde 1970), 0 se desconhecida
+//   amostras ate o fim do payload, cada uma com:
+//     byte     tipo
+//     varint   zigzag(instante - instante da amostra anterior), em ms desde o
+//              boot; a primeira e relativa a 0
+//     campos do tipo (sem sequencia)
+//
+// Saude do firmware (TELEMETRY_HEALTH): publish proprio, no topico de saude.
+//   byte 0   versao, byte 1 TELEMETRY_HEALTH
+//   varint   sequencia
+//   varint   tempo desde o boot (s)
+//   varint   heap livre, varint menor heap livre desde o boot (bytes)
+//   varint   tempo em sono (tickless idle) desde o relatorio anterior, em milesimos
+//   byte     nucleos, seguido da ocupacao de cada um (byte, %)
+//   byte     tasks no sistema (o payload pode levar menos, as de menor CPU ficam de fora)
+//   tasks ate o fim do payload, da maior CPU para a menor, cada uma com:
+//     byte     tamanho do nome, seguido do nome sem '\0' (no maximo TELEMETRY_HEALTH_NAME_LEN)
+//     varint   CPU desde o relatorio anterior, em milesimos de um nucleo
+//     varint   menor folga da pilha desde o boot (palavras)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define TELEMETRY_SCHEMA_VERSION 3
+#define TELEMETRY_MAX_SIZE 24   // Maior mensagem codificada (bytes)
+#define TELEMETRY_JSON_SIZE 96  // Buffer suficiente para telemetry_to_json
+
+typedef enum{
+    TELEMETRY_BEECOUNT = 1, // Contadores acumulados de entrada e saida (com sinal)
+    TELEMETRY_LOADCELL = 2, // Indice da balanca, peso e tara em centesimos de grama
+    TELEMETRY_VOC = 3,      // Indice de VOC do GasIndexAlgorithm
+    TELEMETRY_BATCH = 16,   // Lote de amostras dos tipos acima
+    TELEMETRY_HEALTH = 17   // Saude do firmware (CPU, pilhas e heap)
+} telemetry_type_t;
+
+#define TELEMETRY_HEALTH_NAME_LEN 8  // Nome da task truncado
+#define TELEMETRY_HEALTH_MAX_CORES 2
+
+// Cabecalho da mensagem de saude
+typedef struct{
+    uint32_t uptime_s;
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint16_t sleep_pm; // Milesimos do tempo com o nucleo dormindo
+    uint8_t cores;
+    uint8_t core_busy[TELEMETRY_HEALTH_MAX_CORES]; // %
+    uint8_t task_count;
+} telemetry_health_t;
+
+// Uma task da mensagem de saude
+typedef struct{
+    char name[TELEMETRY_HEALTH_NAME_LEN + 1];
+    uint16_t cpu_pm;     // Milesimos de um nucleo
+    uint32_t stack_free; // Palavras
+} telemetry_task_health_t;
+
+typedef struct{
+    uint8_t type;       // telemetry_type_t
+    uint32_t sequence;
+    union{
+        struct{ int32_t in, out; } beecount;
+        struct{ uint8_t cell; int32_t raw_cg, tare_cg; } loadcell;
+        struct{ int32_t index; } voc;
+    } data;
+} telemetry_message_t;
+
+// Montagem incremental de um lote em um buffer do chamador
+typedef struct{
+    uint8_t *buf;
+    size_t size;
+    size_t length;     // Bytes ja codificados
+    uint16_t count;    // Amostras no lote
+    uint32_t first_ms; // Instante da amostra mais antiga
+    uint32_t last_ms;  // Base do delta da proxima amostra
+} telemetry_batch_t;
+
+// Leitura de um lote recebido
+typedef struct{
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    uint32_t time_ms;
+    uint32_t sequence;
+    uint32_t epoch_at_boot;
+} telemetry_batch_reader_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Retorna o tamanho codificado ou 0 se o buffer nao comporta a mensagem
+size_t telemetry_encode(const telemetry_message_t *msg, uint8_t *buf, size_t size);
+// false se a versao, o tipo ou o tamanho nao conferem
+bool telemetry_decode(const uint8_t *buf, size_t len, telemetry_message_t *msg);
+// JSON equivalente (modo de depuracao e saida do decodificador no host).
+// Retorna o tamanho escrito ou 0 se nao coube.
+size_t telemetry_to_json(const telemetry_message_t *msg, char *buf, size_t size);
+
+// Inicia um lote vazio (so o cabecalho) em buf
+bool telemetry_batch_init(telemetry_batch_t *batch, uint8_t *buf, size_t size, uint32_t sequence, uint32_t epoch_at_boot);
+// Acrescenta uma amostra; false se nao coube (o lote nao e alterado)
+bool telemetry_batch_append(telemetry_batch_t *batch, const telemetry_message_t *msg, uint32_t time_ms);
+// false se o payload nao e um lote desta versao
+bool telemetry_batch_open(telemetry_batch_reader_t *reader, const uint8_t *buf, size_t len);
+// Proxima amostra do lote; false no fim ou se o lote esta corrompido
+bool telemetry_batch_next(telemetry_batch_reader_t *reader, telemetry_message_t *msg, uint32_t *time_ms);
+
+// Mensagem de saude: montada e lida com as mesmas estruturas do lote
+bool telemetry_health_init(telemetry_batch_t *msg, uint8_t *buf, size_t size, uint32_t sequence, const telemetry_health_t *health);
+// Acrescenta uma task; false se nao coube (a mensagem nao e alterada)
+bool telemetry_health_append(telemetry_batch_t *msg, const telemetry_task_health_t *task);
+bool telemetry_health_open(telemetry_batch_reader_t *reader, const uint8_t *buf, size_t len, telemetry_health_t *health);
+bool telemetry_health_next(telemetry_batch_reader_t *reader, telemetry_task_health_t *task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
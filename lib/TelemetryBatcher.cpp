@@ -0,0 +1,85 @@
+#include "TelemetryBatcher.h"
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "WallClock.h"
+
+#ifdef TELEMETRY_JSON
+// Topico de cada tipo no modo de depuracao
+static const char *json_topic(uint8_t type){
+    switch(type){
+        case TELEMETRY_BEECOUNT: return "apissense/beecount";
+        case TELEMETRY_LOADCELL: return "apissense/loadcell"; // Balanca no campo "cell"
+        case TELEMETRY_VOC: return "apissense/voc";
+        default: return "apissense/unknown";
+    }
+}
+#endif
+
+TelemetryBatcher::TelemetryBatcher(MqttClient *client, const char *topic)
+    : _client(client), _topic(topic){
+    _mutex = NULL;
+    _sequence = 0;
+}
+
+bool TelemetryBatcher::begin(){
+    _mutex = _mutexMemory.create("Telemetry");
+    if(_mutex == NULL){
+        printf("[BATCH] Erro ao criar o mutex\n");
+        return false;
+    }
+    start();
+    return true;
+}
+
+void TelemetryBatcher::start(){
+    // A hora do boot vai em cada lote: o host converte os instantes sem depender do SNTP no envio
+    uint32_t boot_time;
+    if(!wall_clock_boot_time(&boot_time)) boot_time = 0;
+    telemetry_batch_init(&_batch, _buffer, sizeof(_buffer), _sequence, boot_time);
+}
+
+void TelemetryBatcher::flushLocked(){
+    if(_batch.count == 0) return;
+    _client->publish(_topic, _buffer, _batch.length);
+    _sequence++;
+    start();
+}
+
+bool TelemetryBatcher::add(const telemetry_message_t *msg, bool urgent){
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+
+#ifdef TELEMETRY_JSON
+    (void)now;
+    (void)urgent;
+    char json[TELEMETRY_JSON_SIZE];
+    size_t length = telemetry_to_json(msg, json, sizeof(json));
+    return length > 0 && _client->publish(json_topic(msg->type), json, length);
+#else
+    bool ok = true;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    // Lote cheio: envia e tenta de novo em um lote vazio
+    if(!telemetry_batch_append(&_batch, msg, now)){
+        flushLocked();
+        ok = telemetry_batch_append(&_batch, msg, now);
+    }
+    if(urgent) flushLocked();
+    xSemaphoreGive(_mutex);
+    if(!ok) printf("[BATCH] Amostra do tipo %u nao coube no lote\n", msg->type);
+    return ok;
+#endif
+}
+
+void TelemetryBatcher::poll(){
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if(_batch.count > 0 && now - _batch.first_ms >= TELEMETRY_BATCH_MAX_AGE_MS)
+        flushLocked();
+    xSemaphoreGive(_mutex);
+}
+
+void TelemetryBatcher::flush(){
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    flushLocked();
+    xSemaphoreGive(_mutex);
+}
@@ -0,0 +1,41 @@
+#ifndef TELEMETRYBATCHER_H
+#define TELEMETRYBATCHER_H
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "KernelMemory.h"
+#include "MqttClient.h"
+#include "telemetry.h"
+
+#define TELEMETRY_BATCH_SIZE MQTT_MAX_PAYLOAD // Um lote por publish
+#define TELEMETRY_BATCH_MAX_AGE_MS (60 * 1000) // Amostra mais antiga espera no maximo isso
+
+// Junta amostras de todos os sensores, com horario, em um unico publish.
+// O lote e enviado quando enche, quando a amostra mais antiga passa de
+// TELEMETRY_BATCH_MAX_AGE_MS (poll) ou na hora, para uma amostra urgente.
+// No modo TELEMETRY_JSON cada amostra sai sozinha em JSON no topico do tipo.
+class TelemetryBatcher{
+    private:
+        MqttClient *_client;
+        const char *_topic;
+        SemaphoreHandle_t _mutex;
+        KernelMutex _mutexMemory;
+        uint8_t _buffer[TELEMETRY_BATCH_SIZE];
+        telemetry_batch_t _batch;
+        uint32_t _sequence;
+
+        void start();
+        void flushLocked();
+
+    public:
+        // Construtor
+        TelemetryBatcher(MqttClient *client, const char *topic);
+
+        // Metodos
+        bool begin();
+        bool add(const telemetry_message_t *msg, bool urgent = false); // Thread-safe
+        void poll();  // Envia o lote se a amostra mais antiga passou da idade maxima
+        void flush();
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "VocStateStore.h"
+#include "Crc32.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+#define VOC_STATE_FLASH_TIMEOUT_MS 100 // Espera maxima para parar o outro nucleo
+
+typedef struct{
+    uint32_t offset;
+    bool erase;           // Apaga o setor de offset antes de gravar
+    const uint8_t *page;  // Pagina a gravar, ou NULL
+} flash_op_t;
+
+// Executa com as interrupcoes desligadas e sem acesso ao XIP (flash_safe_execute)
+static void flash_op(void *param){
+    flash_op_t *op = (flash_op_t *)param;
+    if(op->erase)
+        flash_range_erase(op->offset & ~(FLASH_SECTOR_SIZE - 1), FLASH_SECTOR_SIZE);
+    if(op->page != NULL)
+        flash_range_program(op->offset, op->page, FLASH_PAGE_SIZE);
+}
+
+VocStateStore::VocStateStore(){
+    _sequence = 0;
+    _next_slot = 0;
+}
+
+const voc_state_record_t *VocStateStore::slot(int index){
+    return (const voc_state_record_t *)(XIP_BASE + VOC_STATE_FLASH_OFFSET + index * FLASH_PAGE_SIZE);
+}
+
+bool VocStateStore::isErased(const voc_state_record_t *record){
+    const uint32_t *words = (const uint32_t *)record;
+    for(uint32_t i = 0; i < sizeof(voc_state_record_t) / sizeof(uint32_t); i++)
+        if(words[i] != 0xFFFFFFFF) return false;
+    return true;
+}
+
+bool VocStateStore::isSectorErased(int sector){
+    for(int i = 0; i < VOC_STATE_SECTOR_SLOTS; i++)
+        if(!isErased(slot(sector * VOC_STATE_SECTOR_SLOTS + i))) return false;
+    return true;
+}
+
+bool VocStateStore::restore(GasIndexAlgorithmParams *params, uint32_t *saved_at){
+    // Procura o registro valido mais novo nos dois setores
+    const voc_state_record_t *latest = NULL;
+    int latest_slot = -1;
+    for(int i = 0; i < VOC_STATE_SLOTS; i++){
+        const voc_state_record_t *record = slot(i);
+        if(record->magic != VOC_STATE_MAGIC) continue;
+        if(record->crc != crc32((const uint8_t *)record, offsetof(voc_state_record_t, crc))) continue;
+        if(latest == NULL || (int32_t)(record->sequence - latest->sequence) > 0){
+            latest = record;
+            latest_slot = i;
+        }
+    }
+    _next_slot = (latest_slot + 1) % VOC_STATE_SLOTS;
+    _sequence = 0;
+    if(latest == NULL) return false;
+
+    _sequence = latest->sequence;
+    GasIndexAlgorithm_set_tuning_parameters(params, latest->tuning[0], latest->tuning[1], latest->tuning[2],
+                                            latest->tuning[3], latest->tuning[4], latest->tuning[5]);
+    GasIndexAlgorithm_set_states(params, latest->state0, latest->state1);
+    if(saved_at != NULL) *saved_at = latest->saved_at;
+    return true;
+}
+
+bool VocStateStore::save(const GasIndexAlgorithmParams *params, uint32_t saved_at){
+    voc_state_record_t record;
+    record.magic = VOC_STATE_MAGIC;
+    record.sequence = _sequence + 1;
+    record.saved_at = saved_at;
+    GasIndexAlgorithm_get_states(params, &record.state0, &record.state1);
+    GasIndexAlgorithm_get_tuning_parameters(params, &record.tuning[0], &record.tuning[1], &record.tuning[2],
+                                            &record.tuning[3], &record.tuning[4], &record.tuning[5]);
+    record.crc = crc32((const uint8_t *)&record, offsetof(voc_state_record_t, crc));
+
+    if(!program(&record)) return false;
+    _sequence = record.sequence;
+    return true;
+}
+
+bool VocStateStore::program(const voc_state_record_t *record){
+    static uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, record, sizeof(voc_state_record_t));
+
+    // Pula paginas ja usadas (gravacao interrompida) ate o fim do setor. No
+    // inicio de um setor ele e apagado se preciso: o registro mais novo esta
+    // sempre no outro
+    int target = _next_slot;
+    while(target % VOC_STATE_SECTOR_SLOTS != 0 && !isErased(slot(target)))
+        target = (target + 1) % VOC_STATE_SLOTS;
+
+    flash_op_t op;
+    op.offset = VOC_STATE_FLASH_OFFSET + target * FLASH_PAGE_SIZE;
+    op.erase = (target % VOC_STATE_SECTOR_SLOTS == 0) && !isSectorErased(target / VOC_STATE_SECTOR_SLOTS);
+    op.page = page;
+
+    int status = flash_safe_execute(flash_op, &op, VOC_STATE_FLASH_TIMEOUT_MS);
+    if(status != PICO_OK){
+        printf("[VOC] Falha ao gravar o estado na flash (%d)\n", status);
+        return false;
+    }
+    _next_slot = (target + 1) % VOC_STATE_SLOTS;
+    return true;
+}
+
+void VocStateStore::erase(){
+    flash_op_t op;
+    op.erase = true;
+    op.page = NULL;
+    for(int i = 0; i < VOC_STATE_SECTORS; i++){
+        op.offset = VOC_STATE_FLASH_OFFSET + i * FLASH_SECTOR_SIZE;
+        if(flash_safe_execute(flash_op, &op, VOC_STATE_FLASH_TIMEOUT_MS) != PICO_OK) return;
+    }
+    _sequence = 0;
+    _next_slot = 0;
+}
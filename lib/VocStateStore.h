@@ -0,0 +1,52 @@
+#ifndef VOCSTATESTORE_H
+#define VOCSTATESTORE_H
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "sensirion_gas_index_algorithm.h"
+
+// Dois ultimos setores da flash (A/B), fora da area do programa
+#define VOC_STATE_SECTORS 2
+#define VOC_STATE_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - VOC_STATE_SECTORS * FLASH_SECTOR_SIZE)
+#define VOC_STATE_SECTOR_SLOTS ((int)(FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)) // Um registro por pagina
+#define VOC_STATE_SLOTS (VOC_STATE_SECTORS * VOC_STATE_SECTOR_SLOTS)
+#define VOC_STATE_MAGIC 0x564F4331 // "VOC1"
+
+typedef struct{
+    uint32_t magic;
+    uint32_t sequence;   // Cresce a cada gravacao: o maior valido e o atual
+    uint32_t saved_at;   // Hora real da gravacao (s desde 1970), 0 se desconhecida
+    float state0;        // GasIndexAlgorithm_get_states
+    float state1;
+    int32_t tuning[6];   // GasIndexAlgorithm_get_tuning_parameters
+    uint32_t crc;        // CRC-32 de todos os campos acima
+} voc_state_record_t;
+
+// Checkpoint do estado aprendido pelo GasIndexAlgorithm na flash.
+// Cada gravacao vai para a proxima pagina livre do setor atual. Quando ele
+// enche, a gravacao passa para o outro setor, que so entao e apagado: o
+// registro mais novo nunca esta no setor sendo apagado, entao uma queda de
+// energia no meio nao perde o estado (1 apagamento a cada VOC_STATE_SECTOR_SLOTS
+// gravacoes). O numero de sequencia decide qual registro e o atual, e registros
+// com CRC invalido (gravacao interrompida) sao ignorados.
+class VocStateStore{
+    private:
+        uint32_t _sequence;  // Sequencia do ultimo registro valido
+        int _next_slot;      // Pagina seguinte ao registro mais novo
+
+        static const voc_state_record_t *slot(int index);
+        static bool isErased(const voc_state_record_t *record);
+        static bool isSectorErased(int sector);
+        bool program(const voc_state_record_t *record);
+
+    public:
+        // Construtor
+        VocStateStore();
+
+        // Metodos
+        bool restore(GasIndexAlgorithmParams *params, uint32_t *saved_at); // Aplica o registro mais novo
+        bool save(const GasIndexAlgorithmParams *params, uint32_t saved_at);
+        void erase(); // Descarta o estado salvo (os dois setores)
+};
+
+#endif
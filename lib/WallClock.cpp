@@ -0,0 +1,42 @@
+#include "WallClock.h"
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/apps/sntp.h"
+
+static volatile uint32_t epoch_at_boot = 0; // Hora real - uptime, em segundos
+static volatile bool synced = false;
+static bool started = false;
+
+void wall_clock_start(void){
+    if(started) return;
+    started = true;
+
+    // O lwIP roda em background: as chamadas precisam do lock da arquitetura
+    cyw43_arch_lwip_begin();
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, WALL_CLOCK_NTP_SERVER);
+    sntp_init();
+    cyw43_arch_lwip_end();
+    printf("[SNTP] Sincronizando com %s\n", WALL_CLOCK_NTP_SERVER);
+}
+
+void wall_clock_set(uint32_t seconds){
+    // Guarda so a diferenca para o uptime: escrita de 32 bits e atomica
+    epoch_at_boot = seconds - (uint32_t)(time_us_64() / 1000000);
+    if(!synced) printf("[SNTP] Hora sincronizada: %lu\n", seconds);
+    synced = true;
+}
+
+bool wall_clock_now(uint32_t *seconds){
+    if(!synced) return false;
+    *seconds = epoch_at_boot + (uint32_t)(time_us_64() / 1000000);
+    return true;
+}
+
+bool wall_clock_boot_time(uint32_t *seconds){
+    if(!synced) return false;
+    *seconds = epoch_at_boot;
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef WALLCLOCK_H
+#define WALLCLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WALL_CLOCK_NTP_SERVER "pool.ntp.org"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hora real (segundos desde 1970) obtida por SNTP. A Pico nao tem RTC com
+// bateria, entao a hora so existe depois da primeira sincronizacao.
+void wall_clock_start(void);             // Inicia o SNTP (chamar com o Wi-Fi conectado)
+void wall_clock_set(uint32_t seconds);   // Chamado pelo lwIP (SNTP_SET_SYSTEM_TIME)
+bool wall_clock_now(uint32_t *seconds);  // false enquanto nao sincronizou
+bool wall_clock_boot_time(uint32_t *seconds); // Hora real do boot, false enquanto nao sincronizou
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -12,12 +12,26 @@
 // This example uses a common include to avoid repetition
 #include "lwipopts_examples_common.h"
 
-#define MEMP_NUM_SYS_TIMEOUT        (LWIP_NUM_SYS_TIMEOUT_INTERNAL+1)
+#define MEMP_NUM_SYS_TIMEOUT        (LWIP_NUM_SYS_TIMEOUT_INTERNAL+2) // MQTT + SNTP
+
+// SNTP: hora real para validar a idade do estado salvo do SGP40 (WallClock)
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+void wall_clock_set(uint32_t seconds);
+#ifdef __cplusplus
+}
+#endif
+#define SNTP_SERVER_DNS             1
+#define SNTP_SET_SYSTEM_TIME(sec)   wall_clock_set(sec)
 
 #ifdef MQTT_CERT_INC
 #define LWIP_ALTCP               1
 #define LWIP_ALTCP_TLS           1
 #define LWIP_ALTCP_TLS_MBEDTLS   1
+// O MqttTls instala o alocador do mbedTLS (contabilizado, com teto)
+#define ALTCP_MBEDTLS_PLATFORM_ALLOC 0
 #ifndef NDEBUG
 #define ALTCP_MBEDTLS_DEBUG  LWIP_DBG_ON
 #endif
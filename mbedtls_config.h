@@ -1,6 +1,96 @@
 #ifndef MBEDTLS_CONFIG_TLS_CLIENT_H
 #define MBEDTLS_CONFIG_TLS_CLIENT_H
 
-#include "mbedtls_config_examples_common.h"
+// Perfil enxuto para o MQTT sobre TLS (MqttTls): so cliente TLS 1.2, AES-128-GCM
+// com ECDHE, curvas P-256 e X25519. Cada item que sai economiza flash e, no
+// caso das curvas e das janelas do ECP, RAM durante o handshake. O perfil
+// generico dos exemplos da Pico continua em mbedtls_config_examples_common.h
 
-#endif
\ No newline at end of file
+/* Workaround for some mbedtls source files using INT_MAX without including limits.h */
+#include <limits.h>
+
+#define MBEDTLS_NO_PLATFORM_ENTROPY
+#define MBEDTLS_ENTROPY_HARDWARE_ALT
+
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#define MBEDTLS_HAVE_TIME
+
+// Alocador: o MqttTls instala um calloc/free contabilizado e limitado
+// (MQTT_TLS_HEAP_LIMIT)
+#define MBEDTLS_PLATFORM_C
+#define MBEDTLS_PLATFORM_MEMORY
+
+// Registros: o broker pode mandar registros de 16 KB (o mosquitto nao limita),
+// entao a entrada fica no maximo do TLS. A saida so leva o ClientHello e
+// publicacoes de ate MQTT_MAX_PAYLOAD bytes
+#define MBEDTLS_SSL_IN_CONTENT_LEN     16384
+#define MBEDTLS_SSL_OUT_CONTENT_LEN    2048
+
+// Retomada de sessao: session ticket (RFC 5077) e session id
+#define MBEDTLS_SSL_SESSION_TICKETS
+// MBEDTLS_SSL_KEEP_PEER_CERTIFICATE fica desligado: a sessao guardada leva so o
+// hash do certificado do broker, nao a cadeia inteira
+
+// Suites oferecidas no ClientHello, na ordem de preferencia
+#define MBEDTLS_SSL_CIPHERSUITES \
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, \
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256
+
+/* TLS 1.2, somente cliente */
+#define MBEDTLS_SSL_PROTO_TLS1_2
+#define MBEDTLS_SSL_TLS_C
+#define MBEDTLS_SSL_CLI_C
+#define MBEDTLS_SSL_SERVER_NAME_INDICATION
+#define MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED
+#define MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED
+
+// Troca de chaves: X25519 primeiro (mais rapida), P-256 para brokers sem ela
+#define MBEDTLS_ECP_C
+#define MBEDTLS_ECDH_C
+#define MBEDTLS_ECDSA_C
+#define MBEDTLS_ECP_DP_CURVE25519_ENABLED
+#define MBEDTLS_ECP_DP_SECP256R1_ENABLED
+// The following significantly speeds up mbedtls due to NIST optimizations.
+#define MBEDTLS_ECP_NIST_OPTIM
+// Janela menor e sem tabela fixa: alguns KB a menos no pico do handshake
+#define MBEDTLS_ECP_WINDOW_SIZE        2
+#define MBEDTLS_ECP_FIXED_POINT_OPTIM  0
+
+// Certificado do broker em RSA (ate 2048 bits) ou ECDSA
+#define MBEDTLS_RSA_C
+#define MBEDTLS_PKCS1_V15
+#define MBEDTLS_MPI_MAX_SIZE           256
+#define MBEDTLS_BIGNUM_C
+
+/* Cifra e hashes */
+#define MBEDTLS_AES_C
+#define MBEDTLS_AES_FEWER_TABLES
+#define MBEDTLS_GCM_C
+#define MBEDTLS_CIPHER_C
+#define MBEDTLS_MD_C
+#define MBEDTLS_SHA224_C
+#define MBEDTLS_SHA256_C
+#define MBEDTLS_SHA256_SMALLER
+#define MBEDTLS_SHA384_C
+#define MBEDTLS_SHA512_C
+
+/* Aleatorio */
+#define MBEDTLS_CTR_DRBG_C
+#define MBEDTLS_ENTROPY_C
+
+/* Certificados */
+#define MBEDTLS_ASN1_PARSE_C
+#define MBEDTLS_ASN1_WRITE_C
+#define MBEDTLS_OID_C
+#define MBEDTLS_PK_C
+#define MBEDTLS_PK_PARSE_C
+#define MBEDTLS_X509_USE_C
+#define MBEDTLS_X509_CRT_PARSE_C
+
+// The following is needed to parse a certificate
+#define MBEDTLS_PEM_PARSE_C
+#define MBEDTLS_BASE64_C
+
+#define MBEDTLS_ERROR_C
+
+#endif
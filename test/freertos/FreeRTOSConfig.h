@@ -0,0 +1,47 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+// Configuracao do FreeRTOS para os testes no host (port POSIX): um nucleo,
+// alocacao dinamica (heap_3) e os mesmos indices de notificacao do firmware
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_TICKLESS_IDLE                 0
+#define configUSE_IDLE_HOOK                     0
+#define configUSE_TICK_HOOK                     0
+#define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
+#define configMAX_PRIORITIES                    8
+#define configMINIMAL_STACK_SIZE                ( configSTACK_DEPTH_TYPE ) 256
+#define configUSE_16_BIT_TICKS                  0
+#define configIDLE_SHOULD_YIELD                 1
+
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             0
+#define configUSE_COUNTING_SEMAPHORES           1
+#define configQUEUE_REGISTRY_SIZE               8
+#define configUSE_TIME_SLICING                  1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   2 /* Indice 1: fim de transacao do I2CEngine */
+
+#define configSTACK_DEPTH_TYPE                  uint32_t
+#define configSUPPORT_STATIC_ALLOCATION         0
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configTOTAL_HEAP_SIZE                   (64*1024)
+
+#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configGENERATE_RUN_TIME_STATS           0
+#define configUSE_TRACE_FACILITY                1
+#define configUSE_CO_ROUTINES                   0
+#define configUSE_TIMERS                        0
+#define configNUMBER_OF_CORES                   1
+
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+
+#include <stdio.h>
+#include <stdlib.h>
+#define configASSERT(x) do{ if(!(x)){ fprintf(stderr, "configASSERT %s:%d\n", __FILE__, __LINE__); abort(); } }while(0)
+
+#endif
@@ -0,0 +1,17 @@
+// Porte Q16.16 usado no firmware
+#define GAS_INDEX_ALGORITHM_FIXED_POINT
+#define GAS_INDEX_PREFIX(name) GasIndexFixed_##name
+#include "gas_index_pair.h"
+#include "SGP40/sensirion_gas_index_algorithm_fixed.c"
+
+static GasIndexAlgorithmParams params;
+
+void gas_index_fixed_init(int32_t algorithm_type){
+    GasIndexAlgorithm_init(&params, algorithm_type);
+}
+
+int32_t gas_index_fixed_process(int32_t sraw){
+    int32_t index;
+    GasIndexAlgorithm_process(&params, sraw, &index);
+    return index;
+}
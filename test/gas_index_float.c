@@ -0,0 +1,16 @@
+// Implementacao em float da Sensirion (referencia)
+#define GAS_INDEX_PREFIX(name) GasIndexFloat_##name
+#include "gas_index_pair.h"
+#include "SGP40/sensirion_gas_index_algorithm.c"
+
+static GasIndexAlgorithmParams params;
+
+void gas_index_float_init(int32_t algorithm_type){
+    GasIndexAlgorithm_init(&params, algorithm_type);
+}
+
+int32_t gas_index_float_process(int32_t sraw){
+    int32_t index;
+    GasIndexAlgorithm_process(&params, sraw, &index);
+    return index;
+}
@@ -0,0 +1,26 @@
+// As duas implementacoes do gas index no mesmo binario: cada .c inclui o
+// fonte da Sensirion com a API publica renomeada (GAS_INDEX_PREFIX)
+#ifndef GAS_INDEX_PAIR_H
+#define GAS_INDEX_PAIR_H
+
+#include <stdint.h>
+
+#ifdef GAS_INDEX_PREFIX
+#define GasIndexAlgorithm_init GAS_INDEX_PREFIX(init)
+#define GasIndexAlgorithm_init_with_sampling_interval GAS_INDEX_PREFIX(init_with_sampling_interval)
+#define GasIndexAlgorithm_reset GAS_INDEX_PREFIX(reset)
+#define GasIndexAlgorithm_get_states GAS_INDEX_PREFIX(get_states)
+#define GasIndexAlgorithm_set_states GAS_INDEX_PREFIX(set_states)
+#define GasIndexAlgorithm_set_tuning_parameters GAS_INDEX_PREFIX(set_tuning_parameters)
+#define GasIndexAlgorithm_get_tuning_parameters GAS_INDEX_PREFIX(get_tuning_parameters)
+#define GasIndexAlgorithm_get_sampling_interval GAS_INDEX_PREFIX(get_sampling_interval)
+#define GasIndexAlgorithm_process GAS_INDEX_PREFIX(process)
+#endif
+
+// Uma instancia de cada, com o tipo de algoritmo (VOC/NOx)
+void gas_index_float_init(int32_t algorithm_type);
+int32_t gas_index_float_process(int32_t sraw);
+void gas_index_fixed_init(int32_t algorithm_type);
+int32_t gas_index_fixed_process(int32_t sraw);
+
+#endif
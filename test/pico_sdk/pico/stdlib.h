@@ -0,0 +1,16 @@
+#ifndef _PICO_STDLIB_H
+#define _PICO_STDLIB_H
+
+// Pico SDK reduzido para os modulos da flash rodarem no host: a flash e um
+// vetor em RAM (host_flash) com a semantica de NOR (test_flash_outbox.cpp)
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT -1
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+#endif
@@ -0,0 +1,237 @@
+// Replay de tracos de bordas dos sensores: o BeeGateMatcher tem que contar as
+// mesmas passagens que o algoritmo antigo (filas por canal consumidas a cada
+// 50 ms), alem de expirar os eventos que nunca encontram o par
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "BeeGateMatcher.h"
+
+#define NUM_CHANNELS 8
+#define WINDOW_MS 2000         // BEE_PASSAGE_WINDOW_MS
+#define OLD_TIMEOUT_MS 5000    // BEE_EVENT_TIMEOUT_MS do algoritmo antigo
+#define OLD_POLL_MS 50         // Periodo da vBeeConsumeQueuesTask
+#define OLD_QUEUE_LENGTH 5     // BEE_QUEUE_LENGTH
+
+typedef struct{
+    uint32_t time_ms;
+    uint8_t channel;
+    uint8_t side; // 0 = PORTA (entrada), 1 = PORTB (dentro)
+} edge_t;
+
+typedef struct{
+    int32_t in, out;
+    uint32_t lone; // Bordas sem par geradas no traco
+} counts_t;
+
+// Copia do consume_individual_expander_queue antigo, com ticks de 1 ms
+class OldPolling{
+    private:
+        std::deque<uint32_t> _queue[2][NUM_CHANNELS];
+
+    public:
+        int32_t in = 0, out = 0;
+
+        void push(const edge_t &e){
+            if(_queue[e.side][e.channel].size() < OLD_QUEUE_LENGTH) _queue[e.side][e.channel].push_back(e.time_ms);
+        }
+
+        void poll(uint32_t now){
+            for(int channel = 0; channel < NUM_CHANNELS; channel++){
+                std::deque<uint32_t> &a = _queue[0][channel];
+                std::deque<uint32_t> &b = _queue[1][channel];
+                if(!a.empty() && !b.empty()){
+                    uint32_t entry_time = a.front(), exit_time = b.front();
+                    if(entry_time < exit_time){
+                        if(exit_time - entry_time <= WINDOW_MS){
+                            in++;
+                            a.pop_front();
+                            b.pop_front();
+                        } else {
+                            a.pop_front();
+                        }
+                    } else {
+                        if(entry_time - exit_time <= WINDOW_MS){
+                            out--;
+                            a.pop_front();
+                            b.pop_front();
+                        } else {
+                            b.pop_front();
+                        }
+                    }
+                } else {
+                    if(!a.empty() && now - a.front() > OLD_TIMEOUT_MS) a.pop_front();
+                    if(!b.empty() && now - b.front() > OLD_TIMEOUT_MS) b.pop_front();
+                }
+            }
+        }
+};
+
+static uint32_t rand_range(uint32_t lo, uint32_t hi){
+    return lo + (uint32_t)rand() % (hi - lo + 1);
+}
+
+// Episodios por canal separados por mais que a janela mais um poll: passagens
+// IN/OUT, abelhas que voltam (borda sem par) e ruido de um sensor. Nesse regime
+// os dois algoritmos tem que concordar exatamente
+static std::vector<edge_t> make_trace(uint32_t start_ms, int episodes, counts_t *expected){
+    std::vector<edge_t> trace;
+    *expected = {0, 0, 0};
+    for(uint8_t channel = 0; channel < NUM_CHANNELS; channel++){
+        uint32_t t = start_ms + rand_range(0, 1000);
+        for(int i = 0; i < episodes; i++){
+            uint32_t kind = rand_range(0, 9);
+            if(kind < 4){          // Entrada: A e depois B
+                uint32_t transit = rand_range(20, WINDOW_MS - 100);
+                trace.push_back({t, channel, 0});
+                trace.push_back({t + transit, channel, 1});
+                expected->in++;
+                t += transit;
+            } else if(kind < 8){   // Saida: B e depois A
+                uint32_t transit = rand_range(20, WINDOW_MS - 100);
+                trace.push_back({t, channel, 1});
+                trace.push_back({t + transit, channel, 0});
+                expected->out--;
+                t += transit;
+            } else {               // Abelha que voltou: uma borda so
+                trace.push_back({t, channel, (uint8_t)(kind & 1)});
+                expected->lone++;
+            }
+            t += rand_range(WINDOW_MS + 2 * OLD_POLL_MS, 3 * WINDOW_MS);
+        }
+    }
+    std::stable_sort(trace.begin(), trace.end(), [](const edge_t &x, const edge_t &y){ return x.time_ms < y.time_ms; });
+    return trace;
+}
+
+static void replay(const std::vector<edge_t> &trace, uint32_t start_ms, counts_t *old_counts, counts_t *new_counts,
+                   BeeGateMatcher *matcher){
+    OldPolling old;
+    int32_t in = 0, out = 0;
+    uint32_t poll = start_ms;
+
+    for(const edge_t &e : trace){
+        while(poll < e.time_ms){
+            old.poll(poll);
+            poll += OLD_POLL_MS;
+        }
+        old.push(e);
+
+        // Instantes em us, como o time_us_32() da IRQ
+        bee_passage_t p = matcher->onEdge(e.channel, e.side ? BEE_GATE_EXIT : BEE_GATE_ENTRY, e.time_ms * 1000u);
+        if(p == BEE_PASSAGE_IN) in++;
+        if(p == BEE_PASSAGE_OUT) out--;
+    }
+    uint32_t end = trace.back().time_ms + OLD_TIMEOUT_MS + 2 * OLD_POLL_MS;
+    while(poll < end){
+        old.poll(poll);
+        poll += OLD_POLL_MS;
+    }
+    matcher->expire(end * 1000u);
+
+    *old_counts = {old.in, old.out, 0};
+    *new_counts = {in, out, matcher->getExpired()};
+}
+
+// Casos pontuais: janela, FIFO do canal, expiracao e overflow do contador
+static void test_basic(){
+    BeeGateMatcher m(WINDOW_MS * 1000u);
+    uint32_t transit, deadline;
+
+    assert(!m.nextDeadline(&deadline));
+    assert(m.onEdge(0, BEE_GATE_ENTRY, 1000) == BEE_PASSAGE_NONE);
+    assert(m.nextDeadline(&deadline) && deadline == 1000 + WINDOW_MS * 1000u + 1);
+    assert(m.onEdge(0, BEE_GATE_EXIT, 501000, &transit) == BEE_PASSAGE_IN && transit == 500000);
+    assert(!m.nextDeadline(&deadline));
+
+    // Par fora da janela: o primeiro expira e o segundo fica pendente
+    assert(m.onEdge(1, BEE_GATE_EXIT, 0) == BEE_PASSAGE_NONE);
+    assert(m.onEdge(1, BEE_GATE_ENTRY, WINDOW_MS * 1000u + 1) == BEE_PASSAGE_NONE);
+    assert(m.getExpired() == 1);
+    assert(m.expire(WINDOW_MS * 1000u + 1) == 0);
+    assert(m.expire(2 * WINDOW_MS * 1000u + 2) == 1);
+    assert(m.getExpired() == 2);
+
+    // Mesmo lado enfileira; o lado oposto fecha com o mais antigo
+    assert(m.onEdge(2, BEE_GATE_ENTRY, 10) == BEE_PASSAGE_NONE);
+    assert(m.onEdge(2, BEE_GATE_ENTRY, 20) == BEE_PASSAGE_NONE);
+    assert(m.onEdge(2, BEE_GATE_EXIT, 30, &transit) == BEE_PASSAGE_IN && transit == 20);
+    assert(m.onEdge(2, BEE_GATE_EXIT, 40, &transit) == BEE_PASSAGE_IN && transit == 20);
+
+    // Overflow do contador de 32 bits no meio da passagem
+    assert(m.onEdge(3, BEE_GATE_EXIT, 0xFFFFFF00u) == BEE_PASSAGE_NONE);
+    assert(m.onEdge(3, BEE_GATE_ENTRY, 0x100u, &transit) == BEE_PASSAGE_OUT && transit == 0x200u);
+
+    // Pool cheio: descarta e conta
+    m.reset();
+    for(int i = 0; i < BEE_GATE_POOL_SIZE + 3; i++) m.onEdge(i % BEE_GATE_MAX_CHANNELS, BEE_GATE_ENTRY, i);
+    assert(m.getDropped() == 3);
+    assert(m.expire(BEE_GATE_POOL_SIZE + WINDOW_MS * 1000u + 3) == BEE_GATE_POOL_SIZE);
+    assert(!m.nextDeadline(&deadline));
+}
+
+// Varios expansores: a vExpanderService publica na ordem dos expansores, nao
+// na das IRQs, entao canais diferentes chegam fora de ordem de tempo
+static void test_out_of_order(){
+    BeeGateMatcher m(WINDOW_MS * 1000u);
+    uint32_t deadline;
+
+    assert(m.onEdge(8, BEE_GATE_ENTRY, 3000000) == BEE_PASSAGE_NONE);  // Expansor 1
+    assert(m.onEdge(0, BEE_GATE_ENTRY, 1000000) == BEE_PASSAGE_NONE);  // Expansor 0, IRQ anterior
+    assert(m.onEdge(16, BEE_GATE_EXIT, 2000000) == BEE_PASSAGE_NONE);  // Expansor 2
+    assert(m.nextDeadline(&deadline) && deadline == 1000000 + WINDOW_MS * 1000u + 1);
+
+    // Cada prazo vence na hora, na ordem das IRQs
+    assert(m.expire(1000000 + WINDOW_MS * 1000u + 1) == 1);
+    assert(m.nextDeadline(&deadline) && deadline == 2000000 + WINDOW_MS * 1000u + 1);
+    assert(m.expire(2000000 + WINDOW_MS * 1000u + 1) == 1);
+    assert(m.onEdge(8, BEE_GATE_EXIT, 3500000) == BEE_PASSAGE_IN);
+    assert(!m.nextDeadline(&deadline));
+
+    // Traco aleatorio: a cada atendimento os 4 expansores publicam na ordem
+    // da tabela, com instantes de IRQ em qualquer ordem. Depois do expire
+    // nenhum pendente pode estar fora da janela
+    srand(99);
+    uint32_t now = 0;
+    for(int i = 0; i < 5000; i++){
+        now += rand_range(10000, 400000); // Um canal sempre em ordem
+        for(uint8_t expander = 0; expander < 4; expander++){
+            uint32_t irq = now - rand_range(0, 5000);
+            m.onEdge(expander * 8 + (uint8_t)rand_range(0, 7), rand_range(0, 1) ? BEE_GATE_EXIT : BEE_GATE_ENTRY, irq);
+        }
+        m.expire(now);
+        if(m.nextDeadline(&deadline)) assert((int32_t)(deadline - now) > 0);
+    }
+    assert(m.getDropped() == 0);
+}
+
+int main(){
+    test_basic();
+    test_out_of_order();
+
+    srand(1234);
+    BeeGateMatcher matcher(WINDOW_MS * 1000u);
+    int32_t total_in = 0, total_out = 0;
+    for(int run = 0; run < 500; run++){
+        uint32_t start_ms = rand_range(0, 100000);
+        counts_t expected, old_counts, new_counts;
+        std::vector<edge_t> trace = make_trace(start_ms, 40, &expected);
+
+        matcher.reset();
+        replay(trace, start_ms, &old_counts, &new_counts, &matcher);
+
+        assert(old_counts.in == expected.in && old_counts.out == expected.out);
+        assert(new_counts.in == old_counts.in && new_counts.out == old_counts.out);
+        assert(new_counts.lone == expected.lone);
+        assert(matcher.getDropped() == 0);
+        uint32_t deadline;
+        assert(!matcher.nextDeadline(&deadline));
+        total_in += new_counts.in;
+        total_out += new_counts.out;
+    }
+    printf("bee_gate_matcher: 500 tracos, %d entradas e %d saidas iguais ao algoritmo antigo\n", total_in, total_out);
+    return 0;
+}
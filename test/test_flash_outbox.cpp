@@ -0,0 +1,220 @@
+// FlashOutbox numa flash simulada (NOR: gravar so zera bits, apagar e por
+// setor): queda do broker, reboot com mensagens pendentes, reenvio com PUBACKs
+// perdidos, log cheio e pagina com lixo de uma gravacao interrompida. O broker
+// e o laco de reenvio seguem o MqttClient (replayFlash/processReplayAcks),
+// sem o lwIP
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "FlashOutbox.h"
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+static int safe_executes = 0; // Bloqueios da flash (interrupcoes desligadas)
+static int erases = 0;
+static bool flash_busy = false; // flash_safe_execute falha (o outro nucleo nao parou)
+
+void flash_range_erase(uint32_t flash_offs, size_t count){
+    assert(flash_offs % FLASH_SECTOR_SIZE == 0 && count % FLASH_SECTOR_SIZE == 0);
+    memset(host_flash + flash_offs, 0xFF, count);
+    erases++;
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count){
+    assert(flash_offs % FLASH_PAGE_SIZE == 0 && count % FLASH_PAGE_SIZE == 0);
+    assert(flash_offs + count <= PICO_FLASH_SIZE_BYTES);
+    for(size_t i = 0; i < count; i++)
+        host_flash[flash_offs + i] &= data[i];
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms){
+    (void)enter_exit_timeout_ms;
+    if(flash_busy) return PICO_ERROR_TIMEOUT;
+    safe_executes++;
+    func(param);
+    return PICO_OK;
+}
+
+static const char *TOPIC = "apissense/telemetry";
+
+static void spill(FlashOutbox &outbox, uint32_t first, uint32_t count){
+    // Como o MqttClient::spillToFlash: tudo o que esta na fila da RAM e um flush
+    for(uint32_t id = first; id < first + count; id++){
+        char payload[32];
+        int length = snprintf(payload, sizeof(payload), "msg %u", id);
+        assert(outbox.append(TOPIC, (const uint8_t *)payload, length));
+    }
+    assert(outbox.flush());
+}
+
+static uint32_t payload_id(const uint8_t *payload, uint16_t length){
+    char text[32];
+    assert(length < sizeof(text));
+    memcpy(text, payload, length);
+    text[length] = '\0';
+    return (uint32_t)strtoul(text + 4, NULL, 10);
+}
+
+// Broker com QoS 1: registra as entregas; um PUBACK em cada drop_every se perde
+// (timeout do lwIP) e o cliente recomeca do inicio do log
+static void replay(FlashOutbox &outbox, std::vector<uint32_t> &delivered, int drop_every){
+    const int WINDOW = 4;
+    uint32_t page = outbox.oldest();
+    int sent = 0;
+    while(outbox.pending() > 0){
+        uint32_t pages[WINDOW], sequences[WINDOW];
+        int in_flight = 0;
+        while(in_flight < WINDOW && page != outbox.end()){
+            const char *topic;
+            const uint8_t *payload;
+            uint16_t length;
+            uint32_t sequence;
+            if(outbox.read(page, &topic, &payload, &length, &sequence)){
+                assert(strcmp(topic, TOPIC) == 0);
+                delivered.push_back(payload_id(payload, length));
+                pages[in_flight] = page;
+                sequences[in_flight++] = sequence;
+            }
+            page = FlashOutbox::next(page);
+        }
+        bool rewind = false;
+        for(int i = 0; i < in_flight; i++){
+            if(drop_every && ++sent % drop_every == 0) rewind = true;
+            else outbox.ack(pages[i], sequences[i]);
+        }
+        assert(outbox.flush());
+        if(rewind) page = outbox.oldest();
+    }
+}
+
+static void reboot(FlashOutbox &outbox){
+    outbox = FlashOutbox();
+    assert(outbox.begin());
+}
+
+static void test_outage_and_replay(){
+    FlashOutbox outbox;
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    assert(outbox.begin() && outbox.pending() == 0);
+
+    // Broker fora: 100 mensagens em rajadas de tamanhos variados
+    int before = safe_executes;
+    uint32_t id = 0;
+    for(uint32_t burst = 1; id < 100; burst = burst % 9 + 1){
+        uint32_t count = (id + burst <= 100) ? burst : 100 - id;
+        spill(outbox, id, count);
+        id += count;
+    }
+    assert(outbox.pending() == 100);
+    // Uma gravacao por lote de ate FLASH_OUTBOX_BATCH paginas, nao uma por mensagem
+    assert(safe_executes - before < 50);
+
+    // Reboot no meio da queda: tudo continua pendente, na ordem
+    reboot(outbox);
+    assert(outbox.pending() == 100 && outbox.lost() == 0);
+
+    // Broker de volta, perdendo PUBACKs: tudo chega pelo menos uma vez e a
+    // primeira entrega de cada mensagem segue a ordem de gravacao
+    std::vector<uint32_t> delivered;
+    replay(outbox, delivered, 7);
+    assert(outbox.pending() == 0);
+    std::vector<bool> seen(100, false);
+    uint32_t next_new = 0;
+    for(uint32_t d : delivered){
+        assert(d < 100);
+        if(!seen[d]){
+            assert(d == next_new);
+            seen[d] = true;
+            next_new++;
+        }
+    }
+    assert(next_new == 100 && delivered.size() > 100);
+
+    // Confirmadas nao voltam depois de outro reboot
+    reboot(outbox);
+    assert(outbox.pending() == 0 && outbox.oldest() == outbox.end());
+
+    // Reenvio parcial, reboot, e o resto
+    spill(outbox, 100, 40);
+    delivered.clear();
+    int acked = 0;
+    for(uint32_t page = outbox.oldest(); acked < 15; page = FlashOutbox::next(page)){
+        const char *topic;
+        const uint8_t *payload;
+        uint16_t length;
+        uint32_t sequence;
+        assert(outbox.read(page, &topic, &payload, &length, &sequence));
+        assert(payload_id(payload, length) == 100 + (uint32_t)acked);
+        assert(outbox.ack(page, sequence));
+        acked++;
+    }
+    assert(outbox.flush());
+    reboot(outbox);
+    assert(outbox.pending() == 25);
+    replay(outbox, delivered, 0);
+    assert(delivered.size() == 25 && delivered.front() == 115 && delivered.back() == 139);
+}
+
+static void test_full_log(){
+    FlashOutbox outbox;
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    assert(outbox.begin());
+
+    // Mais mensagens que paginas: o setor mais antigo e apagado inteiro
+    uint32_t total = FLASH_OUTBOX_PAGES + 40;
+    for(uint32_t id = 0; id < total; id += 8)
+        spill(outbox, id, 8);
+    uint32_t lost = outbox.lost();
+    assert(lost > 0 && lost % FLASH_OUTBOX_PAGES_PER_SECTOR == 0);
+    assert(outbox.pending() + lost == total);
+
+    reboot(outbox);
+    assert(outbox.pending() + lost == total);
+    std::vector<uint32_t> delivered;
+    replay(outbox, delivered, 0);
+    assert(delivered.size() == total - lost && delivered.front() == lost && delivered.back() == total - 1);
+}
+
+static void test_interrupted_write(){
+    FlashOutbox outbox;
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    assert(outbox.begin());
+    spill(outbox, 0, 3);
+
+    // Queda de energia no meio da gravacao da pagina seguinte: lixo sem CRC valido
+    uint32_t head = outbox.end();
+    memset(host_flash + FLASH_OUTBOX_OFFSET + head * FLASH_PAGE_SIZE + 8, 0x00, 16);
+    reboot(outbox);
+    assert(outbox.pending() == 3);
+
+    // A proxima mensagem pula para o setor seguinte e continua legivel
+    spill(outbox, 3, 1);
+    assert(outbox.pending() == 4);
+    assert(outbox.end() == FLASH_OUTBOX_PAGES_PER_SECTOR + 1);
+    std::vector<uint32_t> delivered;
+    replay(outbox, delivered, 0);
+    assert(delivered.size() == 4 && delivered.back() == 3);
+
+    // Flash ocupada pelo outro nucleo: o lote se perde e entra em lost()
+    flash_busy = true;
+    char payload[] = "msg 4";
+    assert(outbox.append(TOPIC, (const uint8_t *)payload, 5));
+    assert(!outbox.flush() && outbox.lost() == 1);
+    flash_busy = false;
+    spill(outbox, 5, 1);
+    delivered.clear();
+    replay(outbox, delivered, 0);
+    assert(delivered.size() == 1 && delivered[0] == 5);
+}
+
+int main(){
+    test_outage_and_replay();
+    test_full_log();
+    test_interrupted_write();
+    printf("flash_outbox: queda, reboot, reenvio, log cheio e gravacao interrompida ok (%d bloqueios, %d apagamentos)\n",
+           safe_executes, erases);
+    return 0;
+}
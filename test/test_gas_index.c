@@ -0,0 +1,99 @@
+// Equivalencia do gas index Q16.16 com a referencia em float da Sensirion:
+// tracos sinteticos de SRAW de 300k amostras (~3,5 dias a 1 Hz) com deriva
+// lenta, ruido e quedas periodicas, que levam o indice VOC ate ~500. Tambem
+// mede o tempo por chamada no host (os ciclos no RP2040, sem FPU, so no alvo)
+#undef NDEBUG
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "gas_index_pair.h"
+#include "SGP40/sensirion_gas_index_algorithm.h"
+
+#define NUM_SAMPLES 300000
+
+typedef struct{
+    const char *name;
+    int32_t algorithm_type;
+    double base;     // SRAW medio
+    double drift;    // Amplitude da deriva lenta (periodo de ~12,5 h)
+    double drop;     // Queda de 1000 s a cada 20000 amostras (evento de VOC)
+} trace_t;
+
+typedef struct{
+    int max;       // Maior diferenca em pontos de indice
+    double mean;   // Diferenca media
+    long off;      // Amostras com 4 pontos ou mais de diferenca
+    double ns_float, ns_fixed;
+} result_t;
+
+static uint32_t seed;
+
+static int32_t noise(){
+    seed = seed * 1664525u + 1013904223u;
+    return (int32_t)(seed >> 16) % 200 - 100;
+}
+
+static int32_t sraw_at(const trace_t *trace, long i){
+    double value = trace->base + trace->drift * sin(i / 7200.0);
+    if(i % 20000 > 19000) value -= trace->drop;
+    return (int32_t)value + noise();
+}
+
+static double elapsed_ns(struct timespec *start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec);
+}
+
+static result_t replay(const trace_t *trace){
+    static int32_t sraw[NUM_SAMPLES], expected[NUM_SAMPLES], actual[NUM_SAMPLES];
+    result_t result = {0, 0, 0, 0, 0};
+    struct timespec start;
+
+    seed = 1234;
+    for(long i = 0; i < NUM_SAMPLES; i++)
+        sraw[i] = sraw_at(trace, i);
+
+    gas_index_float_init(trace->algorithm_type);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(long i = 0; i < NUM_SAMPLES; i++)
+        expected[i] = gas_index_float_process(sraw[i]);
+    result.ns_float = elapsed_ns(&start) / NUM_SAMPLES;
+
+    gas_index_fixed_init(trace->algorithm_type);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(long i = 0; i < NUM_SAMPLES; i++)
+        actual[i] = gas_index_fixed_process(sraw[i]);
+    result.ns_fixed = elapsed_ns(&start) / NUM_SAMPLES;
+
+    long sum = 0;
+    for(long i = 0; i < NUM_SAMPLES; i++){
+        int diff = abs(expected[i] - actual[i]);
+        sum += diff;
+        if(diff > result.max) result.max = diff;
+        if(diff >= 4) result.off++;
+    }
+    result.mean = (double)sum / NUM_SAMPLES;
+    return result;
+}
+
+int main(){
+    static const trace_t traces[] = {
+        {"VOC", GasIndexAlgorithm_ALGORITHM_TYPE_VOC, 30000, 2000, 4000},
+        {"VOC amplo", GasIndexAlgorithm_ALGORITHM_TYPE_VOC, 30000, 9000, 12000},
+        {"NOx", GasIndexAlgorithm_ALGORITHM_TYPE_NOX, 16000, 2000, 4000},
+        {"NOx amplo", GasIndexAlgorithm_ALGORITHM_TYPE_NOX, 16000, 9000, 12000},
+    };
+
+    for(unsigned i = 0; i < sizeof(traces) / sizeof(traces[0]); i++){
+        result_t r = replay(&traces[i]);
+        printf("%-10s max %d, media %.3f, %ld amostras >= 4 | float %.0f ns, Q16.16 %.0f ns por amostra\n",
+               traces[i].name, r.max, r.mean, r.off, r.ns_float, r.ns_fixed);
+        assert(r.max <= 2);
+        assert(r.mean < 0.1);
+        assert(r.off == 0);
+    }
+    return 0;
+}
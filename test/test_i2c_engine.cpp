@@ -0,0 +1,157 @@
+// I2CEngine com um transporte mock no FreeRTOS do host: a fila HIGH sempre
+// passa na frente da NORMAL, TX_ABRT e timeout voltam como erro e, antes do
+// scheduler, as transferencias usam o modo bloqueante do transporte
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "I2CEngine.h"
+
+typedef enum{
+    MOCK_OK = 0,  // STOP_DET: aviso imediato
+    MOCK_ABORT,   // TX_ABRT (NACK): aviso imediato com erro
+    MOCK_TIMEOUT  // Nenhum aviso: o motor tem que desistir sozinho
+} mock_behavior_t;
+
+// Barramento simulado: registra a ordem das transacoes e responde cada leitura
+// com o proprio endereco
+class MockTransport : public I2CTransport{
+    private:
+        bool _aborted;
+
+    public:
+        mock_behavior_t behavior[128]; // Comportamento por endereco
+        uint8_t order[64];             // Enderecos na ordem em que foram executados
+        int count = 0;
+        int blocking = 0;              // Transferencias pelo modo bloqueante
+        int recovered = 0;             // Recuperacoes do barramento depois de erro
+        bool irq = false;
+
+        MockTransport(){
+            memset(behavior, 0, sizeof(behavior));
+            _aborted = false;
+        }
+
+        bool begin() override{
+            return true;
+        }
+
+        void enableIrq() override{
+            irq = true;
+        }
+
+        void start(const i2c_transaction_t *t, TaskHandle_t notify) override{
+            assert(t->tx_len + t->rx_len > 0 && t->tx_len + t->rx_len <= I2C_ENGINE_MAX_LEN);
+            if(count < (int)sizeof(order)) order[count++] = t->address;
+            _aborted = behavior[t->address] == MOCK_ABORT;
+            if(behavior[t->address] != MOCK_TIMEOUT){
+                for(uint16_t i = 0; i < t->rx_len; i++) t->rx[i] = t->address;
+                xTaskNotifyGiveIndexed(notify, I2C_ENGINE_NOTIFY_INDEX); // "IRQ"
+            }
+        }
+
+        int finish(const i2c_transaction_t *t, bool completed) override{
+            if(!completed || _aborted){
+                recovered++;
+                return I2C_ENGINE_ERROR;
+            }
+            return t->tx_len + t->rx_len;
+        }
+
+        int transferBlocking(const i2c_transaction_t *t) override{
+            blocking++;
+            if(behavior[t->address] != MOCK_OK) return I2C_ENGINE_ERROR;
+            for(uint16_t i = 0; i < t->rx_len; i++) t->rx[i] = t->address;
+            return t->tx_len + t->rx_len;
+        }
+};
+
+static MockTransport mock;
+static I2CEngine engine(&mock);
+
+static void test_blocking_before_scheduler(){
+    uint8_t reg = 0x12, value = 0;
+    assert(engine.begin(3));
+    assert(engine.transfer(0x20, &reg, 1, &value, 1) == 2 && value == 0x20);
+    assert(i2c_engine_transfer(0x21, &reg, 1, NULL, 0, I2C_PRIORITY_HIGH) == 1);
+    mock.behavior[0x22] = MOCK_ABORT;
+    assert(engine.transfer(0x22, &reg, 1, NULL, 0) == I2C_ENGINE_ERROR);
+    assert(mock.blocking == 3 && mock.count == 0);
+}
+
+static void test_priorities(){
+    static uint8_t reg = 0;
+    static uint8_t rx[8][1];
+    static i2c_transaction_t t[8];
+
+    // O motor (prioridade 3) fica abaixo desta task: tudo entra na fila antes
+    // de ele rodar. NORMAL primeiro, HIGH depois
+    int base = mock.count;
+    for(int i = 0; i < 8; i++){
+        bool high = i >= 4;
+        t[i] = {};
+        t[i].address = (uint8_t)((high ? 0x40 : 0x30) + i);
+        t[i].tx = &reg;
+        t[i].tx_len = 1;
+        t[i].rx = rx[i];
+        t[i].rx_len = 1;
+        t[i].notify = (i == 3) ? xTaskGetCurrentTaskHandle() : NULL; // Ultima NORMAL avisa
+        assert(engine.submit(&t[i], high ? I2C_PRIORITY_HIGH : I2C_PRIORITY_NORMAL));
+    }
+    assert(mock.count == base);
+    ulTaskNotifyTakeIndexed(I2C_ENGINE_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(1000));
+
+    assert(mock.count == base + 8);
+    for(int i = 0; i < 4; i++) assert(mock.order[base + i] == 0x40 + 4 + i); // HIGH em ordem
+    for(int i = 0; i < 4; i++) assert(mock.order[base + 4 + i] == 0x30 + i); // Depois NORMAL
+    for(int i = 0; i < 8; i++) assert(t[i].result == 2 && rx[i][0] == t[i].address);
+}
+
+static void test_errors(){
+    uint8_t reg = 0, value = 0;
+    uint32_t errors = engine.getErrors();
+
+    // NACK: TX_ABRT avisa na hora
+    mock.behavior[0x50] = MOCK_ABORT;
+    assert(engine.transfer(0x50, &reg, 1, &value, 1) == I2C_ENGINE_ERROR);
+    assert(engine.getErrors() == errors + 1 && mock.recovered == 1);
+
+    // Sem aviso: o motor desiste no timeout e recupera o barramento
+    mock.behavior[0x51] = MOCK_TIMEOUT;
+    TickType_t start = xTaskGetTickCount();
+    assert(engine.transfer(0x51, &reg, 1, NULL, 0, I2C_PRIORITY_HIGH) == I2C_ENGINE_ERROR);
+    assert(xTaskGetTickCount() - start >= pdMS_TO_TICKS(10));
+    assert(engine.getErrors() == errors + 2 && mock.recovered == 2);
+
+    // O barramento continua funcionando depois dos erros
+    assert(engine.transfer(0x52, &reg, 1, &value, 1) == 2 && value == 0x52);
+
+    // Tamanhos invalidos nem chegam ao transporte
+    int count = mock.count;
+    uint8_t big[I2C_ENGINE_MAX_LEN + 1] = {};
+    assert(engine.transfer(0x53, big, sizeof(big), NULL, 0) == I2C_ENGINE_ERROR);
+    assert(engine.transfer(0x53, NULL, 0, NULL, 0) == I2C_ENGINE_ERROR);
+    assert(mock.count == count);
+}
+
+static void testTask(void *params){
+    (void)params;
+    // Deixa o motor habilitar a "IRQ" e esperar trabalho. No port POSIX um tick
+    // pode chegar antes de a thread do motor rodar, entao espera alguns
+    for(int i = 0; i < 100 && !mock.irq; i++)
+        vTaskDelay(1);
+    assert(mock.irq);
+    test_priorities();
+    test_errors();
+    printf("i2c_engine: prioridades, erros e modo bloqueante ok\n");
+    exit(0);
+}
+
+int main(){
+    test_blocking_before_scheduler();
+    // O teste fica acima do motor (prioridade 3)
+    xTaskCreate(testTask, "Test", configMINIMAL_STACK_SIZE * 4, NULL, 4, NULL);
+    vTaskStartScheduler();
+    return 1;
+}
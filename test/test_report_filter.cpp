@@ -0,0 +1,109 @@
+// ReportFilter (report by exception): primeira amostra, banda morta relativa
+// com referencia 0, degrau urgente contra a amostra anterior (nao a enviada),
+// heartbeat com o contador de ms dando a volta e limites desligados
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "ReportFilter.h"
+
+static void test_first_sample(){
+    // Sem variacao, sem heartbeat: mesmo assim a primeira vai
+    ReportFilter f({1000, 0, 0, 0});
+    assert(f.check(0, 5) == REPORT_SEND);
+    assert(f.check(0, 10) == REPORT_SKIP);
+    assert(f.check(999, 15) == REPORT_SKIP);
+
+    // Nem a primeira vira urgente, mesmo longe de _prev = 0
+    ReportFilter g({1000, 0, 10, 0});
+    assert(g.check(-50000, 0) == REPORT_SEND);
+
+    // Depois do reset a proxima amostra e a "primeira" de novo
+    f.reset();
+    assert(f.check(1, 20) == REPORT_SEND);
+    assert(f.getSent() == 2 && f.getSkipped() == 2);
+}
+
+static void test_relative_from_zero(){
+    // 1% do ultimo enviado; com o ultimo em 0 a banda relativa e 0: qualquer variacao vai
+    ReportFilter f({0, 10, 0, 0});
+    assert(f.check(0, 0) == REPORT_SEND);
+    assert(f.check(0, 1) == REPORT_SKIP); // Sem variacao nao envia
+    assert(f.check(1, 2) == REPORT_SEND);
+    // Agora a referencia e 1: 1% de 1 arredonda para qualquer variacao tambem
+    assert(f.check(2, 3) == REPORT_SEND);
+
+    // Com a referencia em 10000, so 100 ou mais (1%), para cima ou para baixo
+    assert(f.check(10000, 4) == REPORT_SEND);
+    assert(f.check(10099, 5) == REPORT_SKIP);
+    assert(f.check(9901, 6) == REPORT_SKIP);
+    assert(f.check(10100, 7) == REPORT_SEND);
+    assert(f.check(10000, 8) == REPORT_SKIP); // 100 de 10100 ja e menos de 1%
+    // Referencia negativa usa o modulo
+    assert(f.check(-10000, 9) == REPORT_SEND);
+    assert(f.check(-10099, 10) == REPORT_SKIP);
+    assert(f.check(-9900, 11) == REPORT_SEND);
+}
+
+static void test_urgent_step(){
+    // Banda de 100, degrau urgente de 50 entre duas amostras seguidas
+    ReportFilter f({100, 0, 50, 0});
+    assert(f.check(0, 0) == REPORT_SEND);
+    // Deriva lenta: a distancia ao ultimo enviado passa do degrau, mas cada passo e pequeno
+    assert(f.check(40, 1) == REPORT_SKIP);
+    assert(f.check(80, 2) == REPORT_SKIP);  // 80 do enviado, 40 da anterior: nao e urgente
+    assert(f.check(120, 3) == REPORT_SEND); // So a banda morta
+    // Degrau de 50 desde a amostra anterior
+    assert(f.check(170, 4) == REPORT_URGENT);
+    // Degrau para baixo tambem conta
+    assert(f.check(110, 5) == REPORT_URGENT);
+    // Uma amostra pulada ainda vira a base do proximo degrau
+    assert(f.check(140, 6) == REPORT_SKIP);
+    assert(f.check(190, 7) == REPORT_URGENT); // 50 da pulada, 80 da enviada
+    // Extremos de int32: a diferenca em 64 bits nao estoura
+    assert(f.check(INT32_MIN, 8) == REPORT_URGENT);
+    assert(f.check(INT32_MAX, 9) == REPORT_URGENT);
+}
+
+static void test_heartbeat_wrap(){
+    // Sem variacao, um envio por minuto, com o contador de 32 bits dando a volta no meio
+    const uint32_t HEARTBEAT = 60000;
+    ReportFilter f({1000, 0, 0, HEARTBEAT});
+    uint32_t start = 0xFFFFF000u;
+    assert(f.check(7, start) == REPORT_SEND);
+    assert(f.check(7, start + 4096) == REPORT_SKIP); // Ja passou de 0
+    assert(f.check(7, start + HEARTBEAT - 1) == REPORT_SKIP);
+    assert(f.check(7, start + HEARTBEAT) == REPORT_SEND);
+    // O proximo conta a partir do ultimo envio
+    assert(f.check(7, start + 2 * HEARTBEAT - 1) == REPORT_SKIP);
+    assert(f.check(7, start + 2 * HEARTBEAT) == REPORT_SEND);
+
+    // Uma amostra por segundo por 60 dias (passa da volta de 49,7 dias): um heartbeat por periodo
+    ReportFilter g({1000, 0, 0, HEARTBEAT});
+    uint32_t now = 0;
+    uint32_t sent = 0;
+    for(uint32_t s = 0; s < 60u * 24 * 3600; s++, now += 1000)
+        if(g.check(0, now) != REPORT_SKIP) sent++;
+    assert(sent == 60u * 24 * 60);
+}
+
+static void test_thresholds_off(){
+    // Banda absoluta e relativa desligadas: qualquer variacao, nada sem variacao
+    ReportFilter f({0, 0, 0, 0});
+    assert(f.check(5, 0) == REPORT_SEND);
+    assert(f.check(5, 1000000) == REPORT_SKIP); // Sem heartbeat
+    assert(f.check(6, 1000001) == REPORT_SEND);
+    assert(f.check(5, 1000002) == REPORT_SEND);
+    assert(f.check(5, 1000003) == REPORT_SKIP);
+    assert(f.getSent() == 3 && f.getSkipped() == 2);
+}
+
+int main(){
+    test_first_sample();
+    test_relative_from_zero();
+    test_urgent_step();
+    test_heartbeat_wrap();
+    test_thresholds_off();
+    printf("report_filter: primeira amostra, banda relativa, degrau urgente, heartbeat na volta e limites desligados ok\n");
+    return 0;
+}
@@ -0,0 +1,261 @@
+// Codificador e decodificador da telemetria binaria: ida e volta de cada tipo
+// (zigzag com sinal, extremos de int32), lote com instantes que passam pela
+// volta do contador de ms, mensagem de saude com nome truncado, versao errada
+// e payload cortado em qualquer ponto
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "Telemetry/telemetry.h"
+
+static telemetry_message_t message(uint8_t type, uint32_t sequence, int32_t a, int32_t b, uint8_t cell){
+    telemetry_message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = type;
+    msg.sequence = sequence;
+    switch(type){
+        case TELEMETRY_BEECOUNT:
+            msg.data.beecount.in = a;
+            msg.data.beecount.out = b;
+            break;
+        case TELEMETRY_LOADCELL:
+            msg.data.loadcell.cell = cell;
+            msg.data.loadcell.raw_cg = a;
+            msg.data.loadcell.tare_cg = b;
+            break;
+        case TELEMETRY_VOC:
+            msg.data.voc.index = a;
+            break;
+    }
+    return msg;
+}
+
+static bool same(const telemetry_message_t *x, const telemetry_message_t *y){
+    if(x->type != y->type) return false;
+    switch(x->type){
+        case TELEMETRY_BEECOUNT:
+            return x->data.beecount.in == y->data.beecount.in && x->data.beecount.out == y->data.beecount.out;
+        case TELEMETRY_LOADCELL:
+            return x->data.loadcell.cell == y->data.loadcell.cell &&
+                   x->data.loadcell.raw_cg == y->data.loadcell.raw_cg &&
+                   x->data.loadcell.tare_cg == y->data.loadcell.tare_cg;
+        case TELEMETRY_VOC:
+            return x->data.voc.index == y->data.voc.index;
+        default:
+            return false;
+    }
+}
+
+static const int32_t VALUES[] = {0, 1, -1, 63, -64, 64, -65, 100000, -100000, INT32_MAX, INT32_MIN};
+#define NUM_VALUES (sizeof(VALUES) / sizeof(VALUES[0]))
+
+static void test_round_trip(){
+    static const uint8_t types[] = {TELEMETRY_BEECOUNT, TELEMETRY_LOADCELL, TELEMETRY_VOC};
+    static const uint32_t sequences[] = {0, 127, 128, UINT32_MAX};
+    uint8_t buf[TELEMETRY_MAX_SIZE];
+    char json[TELEMETRY_JSON_SIZE];
+    int count = 0;
+
+    for(size_t t = 0; t < sizeof(types); t++)
+        for(size_t s = 0; s < sizeof(sequences) / sizeof(sequences[0]); s++)
+            for(size_t i = 0; i < NUM_VALUES; i++)
+                for(size_t j = 0; j < NUM_VALUES; j++){
+                    telemetry_message_t msg = message(types[t], sequences[s], VALUES[i], VALUES[j], (uint8_t)(i * 25)), out;
+                    size_t n = telemetry_encode(&msg, buf, sizeof(buf));
+                    assert(n > 0 && n <= TELEMETRY_MAX_SIZE);
+                    assert(telemetry_decode(buf, n, &out));
+                    assert(same(&msg, &out) && out.sequence == msg.sequence);
+                    // O maior JSON (extremos de int32) tambem cabe no buffer declarado
+                    assert(telemetry_to_json(&msg, json, sizeof(json)) > 0);
+
+                    // Buffer menor que a mensagem: 0, sem escrever pela metade como sucesso
+                    for(size_t size = 0; size < n; size++)
+                        assert(telemetry_encode(&msg, buf, size) == 0);
+                    count++;
+                }
+
+    // Centesimos negativos no JSON sem ponto flutuante
+    telemetry_message_t msg = message(TELEMETRY_LOADCELL, 7, -5, -12345, 2);
+    assert(telemetry_to_json(&msg, json, sizeof(json)) > 0);
+    assert(strcmp(json, "{\"seq\": 7, \"cell\": 2, \"raw\": -0.05, \"tare\": -123.45}") == 0);
+
+    // Lote e saude nao sao mensagens avulsas; tipo desconhecido e recusado
+    msg.type = TELEMETRY_BATCH;
+    assert(telemetry_encode(&msg, buf, sizeof(buf)) == 0);
+    msg.type = 99;
+    assert(telemetry_encode(&msg, buf, sizeof(buf)) == 0);
+    printf("telemetry: %d mensagens avulsas ida e volta\n", count);
+}
+
+static void test_rejects(){
+    uint8_t buf[TELEMETRY_MAX_SIZE + 8];
+    telemetry_message_t msg = message(TELEMETRY_LOADCELL, 300, -2, 40000, 1), out;
+    size_t n = telemetry_encode(&msg, buf, sizeof(buf));
+    assert(n > 0);
+
+    // Cortado em qualquer ponto
+    for(size_t len = 0; len < n; len++)
+        assert(!telemetry_decode(buf, len, &out));
+    // Lixo depois da mensagem
+    buf[n] = 0;
+    assert(!telemetry_decode(buf, n + 1, &out));
+
+    // Versao do schema errada
+    buf[0] = TELEMETRY_SCHEMA_VERSION - 1;
+    assert(!telemetry_decode(buf, n, &out));
+    buf[0] = TELEMETRY_SCHEMA_VERSION + 1;
+    assert(!telemetry_decode(buf, n, &out));
+    buf[0] = '{'; // JSON
+    assert(!telemetry_decode(buf, n, &out));
+
+    // Varint com mais de 5 bytes nao e um uint32
+    static const uint8_t long_varint[] = {TELEMETRY_SCHEMA_VERSION, TELEMETRY_VOC, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01, 0x00};
+    assert(!telemetry_decode(long_varint, sizeof(long_varint), &out));
+    // Indice da balanca acima de um byte
+    static const uint8_t big_cell[] = {TELEMETRY_SCHEMA_VERSION, TELEMETRY_LOADCELL, 0x00, 0x80, 0x02, 0x00, 0x00};
+    assert(!telemetry_decode(big_cell, sizeof(big_cell), &out));
+}
+
+static void test_batch(){
+    // Instantes em ms desde o boot, atravessando a volta do uint32 (49,7 dias),
+    // com um atraso (amostra fora de ordem) no meio
+    static const uint32_t times[] = {0xFFFFF000u, 0xFFFFFC18u, 0xFFFFFFFFu, 0x00000000u, 0x000003E8u,
+                                     0x00000100u, 0x7FFFFFFFu, 0x80000000u};
+    enum{ NUM_SAMPLES = sizeof(times) / sizeof(times[0]) };
+    telemetry_message_t msgs[NUM_SAMPLES];
+    size_t ends[NUM_SAMPLES];
+    uint8_t buf[128];
+    telemetry_batch_t batch;
+    telemetry_batch_reader_t reader;
+    telemetry_message_t out;
+    uint32_t time_ms;
+
+    assert(telemetry_batch_init(&batch, buf, sizeof(buf), 42, 1700000000u));
+    for(int i = 0; i < NUM_SAMPLES; i++){
+        uint8_t type = (uint8_t)(TELEMETRY_BEECOUNT + i % 3);
+        msgs[i] = message(type, 0, -i * 1000, i, (uint8_t)i);
+        assert(telemetry_batch_append(&batch, &msgs[i], times[i]));
+        ends[i] = batch.length;
+    }
+    assert(batch.count == NUM_SAMPLES && batch.first_ms == times[0]);
+
+    assert(telemetry_batch_open(&reader, buf, batch.length));
+    assert(reader.sequence == 42 && reader.epoch_at_boot == 1700000000u);
+    for(int i = 0; i < NUM_SAMPLES; i++){
+        assert(telemetry_batch_next(&reader, &out, &time_ms));
+        assert(same(&msgs[i], &out) && out.sequence == 42 && time_ms == times[i]);
+    }
+    assert(!telemetry_batch_next(&reader, &out, &time_ms));
+
+    // Cortado em qualquer ponto: so as amostras inteiras saem, e na ordem
+    for(size_t len = 0; len < batch.length; len++){
+        if(!telemetry_batch_open(&reader, buf, len)) continue;
+        int complete = 0;
+        while(complete < NUM_SAMPLES && ends[complete] <= len) complete++;
+        int read = 0;
+        while(telemetry_batch_next(&reader, &out, &time_ms)){
+            assert(read < complete && same(&msgs[read], &out) && time_ms == times[read]);
+            read++;
+        }
+        assert(read == complete);
+    }
+
+    // Lote cheio: a amostra que nao coube nao altera o lote
+    telemetry_batch_t small;
+    uint8_t small_buf[16];
+    assert(telemetry_batch_init(&small, small_buf, sizeof(small_buf), 1, 0));
+    telemetry_message_t big = message(TELEMETRY_BEECOUNT, 0, INT32_MIN, INT32_MIN, 0);
+    size_t length = small.length;
+    assert(!telemetry_batch_append(&small, &big, 1000));
+    assert(small.length == length && small.count == 0 && small.last_ms == 0);
+    assert(telemetry_batch_append(&small, &msgs[0], 1000) && small.count == 1);
+
+    // Versao errada e mensagem de outro tipo
+    buf[0] = TELEMETRY_SCHEMA_VERSION - 1;
+    assert(!telemetry_batch_open(&reader, buf, batch.length));
+    buf[0] = TELEMETRY_SCHEMA_VERSION;
+    buf[1] = TELEMETRY_HEALTH;
+    assert(!telemetry_batch_open(&reader, buf, batch.length));
+}
+
+static void test_health(){
+    static const char *names[] = {"MQTT", "I2CEngine", "IDLE0", "TaskWithALongName"};
+    static const char *truncated[] = {"MQTT", "I2CEngin", "IDLE0", "TaskWith"};
+    enum{ NUM_TASKS = sizeof(names) / sizeof(names[0]) };
+    uint8_t buf[96];
+    telemetry_batch_t msg;
+    telemetry_batch_reader_t reader;
+    telemetry_health_t health, out;
+    telemetry_task_health_t task, task_out;
+    size_t ends[NUM_TASKS];
+
+    memset(&health, 0, sizeof(health));
+    health.uptime_s = 5000000;
+    health.heap_free = 12345;
+    health.heap_min_free = 2048;
+    health.sleep_pm = 873;
+    health.cores = 2;
+    health.core_busy[0] = 12;
+    health.core_busy[1] = 100;
+    health.task_count = 9; // Mais tasks no sistema que no payload
+    assert(telemetry_health_init(&msg, buf, sizeof(buf), UINT32_MAX, &health));
+    size_t header = msg.length;
+    for(int i = 0; i < NUM_TASKS; i++){
+        memset(&task, 0, sizeof(task));
+        strncpy(task.name, names[i], TELEMETRY_HEALTH_NAME_LEN); // Sem '\0' quando o nome e longo
+        task.cpu_pm = (uint16_t)(1000 - i * 300);
+        task.stack_free = 100u << (i * 5);
+        assert(telemetry_health_append(&msg, &task));
+        ends[i] = msg.length;
+    }
+
+    assert(telemetry_health_open(&reader, buf, msg.length, &out));
+    assert(reader.sequence == UINT32_MAX && out.uptime_s == health.uptime_s);
+    assert(out.heap_free == health.heap_free && out.heap_min_free == health.heap_min_free);
+    assert(out.sleep_pm == 873 && out.cores == 2 && out.core_busy[0] == 12 && out.core_busy[1] == 100);
+    assert(out.task_count == 9);
+    for(int i = 0; i < NUM_TASKS; i++){
+        assert(telemetry_health_next(&reader, &task_out));
+        assert(strcmp(task_out.name, truncated[i]) == 0);
+        assert(task_out.cpu_pm == 1000 - i * 300 && task_out.stack_free == 100u << (i * 5));
+    }
+    assert(!telemetry_health_next(&reader, &task_out));
+
+    // Cortado em qualquer ponto: o cabecalho inteiro ou nada, e so as tasks inteiras
+    for(size_t len = 0; len < msg.length; len++){
+        if(!telemetry_health_open(&reader, buf, len, &out)){
+            assert(len < header);
+            continue;
+        }
+        assert(len >= header);
+        int complete = 0;
+        while(complete < NUM_TASKS && ends[complete] <= len) complete++;
+        int read = 0;
+        while(telemetry_health_next(&reader, &task_out)) read++;
+        assert(read == complete);
+    }
+
+    // Nucleos alem do maximo: nem codifica nem decodifica
+    health.cores = TELEMETRY_HEALTH_MAX_CORES + 1;
+    assert(!telemetry_health_init(&msg, buf, sizeof(buf), 0, &health));
+    buf[header - 2 - TELEMETRY_HEALTH_MAX_CORES] = TELEMETRY_HEALTH_MAX_CORES + 1;
+    assert(!telemetry_health_open(&reader, buf, sizeof(buf), &out));
+
+    // Versao errada e lote no lugar da saude
+    health.cores = 2;
+    assert(telemetry_health_init(&msg, buf, sizeof(buf), 0, &health));
+    buf[0] = TELEMETRY_SCHEMA_VERSION + 1;
+    assert(!telemetry_health_open(&reader, buf, msg.length, &out));
+    buf[0] = TELEMETRY_SCHEMA_VERSION;
+    buf[1] = TELEMETRY_BATCH;
+    assert(!telemetry_health_open(&reader, buf, msg.length, &out));
+}
+
+int main(){
+    test_round_trip();
+    test_rejects();
+    test_batch();
+    test_health();
+    printf("telemetry: lote na volta do contador, saude, versao errada e payload cortado ok\n");
+    return 0;
+}